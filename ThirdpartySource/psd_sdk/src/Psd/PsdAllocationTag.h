@@ -0,0 +1,23 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Allocators
+/// \namespace allocationTag
+/// \brief A namespace holding the tags the parser attributes its allocations to, see \ref TrackingAllocator.
+/// \details Tags are compared by their contents, so custom tags can be passed to \ref Allocator::Allocate as well.
+namespace allocationTag
+{
+	static const char* const CHANNEL_DATA = "channel-data";					///< Decoded planar data of layer channels, masks and the merged image.
+	static const char* const COMPRESSED_DATA = "compressed-data";			///< Compressed channel data read from the file.
+	static const char* const DECODE_SCRATCH = "decode-scratch";				///< Rows, scan line tables and bookkeeping needed while decoding.
+	static const char* const INTERLEAVED_IMAGE = "interleaved-image";		///< Interleaved images returned to the caller.
+	static const char* const LAYER_RECORDS = "layer-records";				///< Layers, their channels, masks and names.
+	static const char* const IMAGE_RESOURCES = "image-resources";			///< Image resources like the ICC profile, metadata and thumbnail.
+}
+
+PSD_NAMESPACE_END
@@ -22,6 +22,14 @@ void* Allocator::Allocate(size_t size, size_t alignment)
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* Allocator::Allocate(size_t size, size_t alignment, const char* tag)
+{
+	return DoAllocateTagged(size, alignment, tag);
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void Allocator::Free(void* ptr)
@@ -29,4 +37,12 @@ void Allocator::Free(void* ptr)
 	DoFree(ptr);
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* Allocator::DoAllocateTagged(size_t size, size_t alignment, const char*)
+{
+	return DoAllocate(size, alignment);
+}
+
 PSD_NAMESPACE_END
@@ -12,7 +12,7 @@ PSD_NAMESPACE_BEGIN
 /// \details Memory allocators are used throughout the library to ensure full control over all allocations. This allows
 /// using custom allocators for better performance, a smaller memory footprint, and for adding extra debugging and/or tracking
 /// features.
-/// \sa MallocAllocator
+/// \sa MallocAllocator TrackingAllocator
 class Allocator
 {
 public:
@@ -22,12 +22,18 @@ public:
 	/// Allocates \a size bytes with a given \a alignment. The alignment must be a power-of-two.
 	void* Allocate(size_t size, size_t alignment);
 
+	/// Allocates \a size bytes with a given \a alignment like \ref Allocate, and attributes the allocation to a \a tag
+	/// that describes what the memory is used for, see \ref allocationTag. Allocators that do not track allocations ignore the tag.
+	void* Allocate(size_t size, size_t alignment, const char* tag);
+
 	/// Frees an allocation.
 	void Free(void* ptr);
 
 private:
 	virtual void* DoAllocate(size_t size, size_t alignment) PSD_ABSTRACT;
 	virtual void DoFree(void* ptr) PSD_ABSTRACT;
+
+	virtual void* DoAllocateTagged(size_t size, size_t alignment, const char* tag);
 };
 
 PSD_NAMESPACE_END
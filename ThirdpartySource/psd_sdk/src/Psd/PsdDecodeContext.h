@@ -0,0 +1,37 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace decodeBuffer
+/// \brief A namespace holding the kinds of scratch buffers stored in a \ref DecodeContext.
+namespace decodeBuffer
+{
+	enum Enum
+	{
+		CHANNEL_DATA = 0,						///< Compressed channel data of a layer that was read from the file.
+		CHANNEL_TASKS,							///< Bookkeeping data for decoding the channels of a layer.
+		ROW_DATA,								///< A single row needed for undoing the prediction of 32-bit ZIP-compressed data.
+
+		COUNT
+	};
+}
+
+
+/// \ingroup Types
+/// \class DecodeContext
+/// \brief A struct storing scratch buffers that are reused by all calls to \ref ExtractLayer it is passed to.
+/// \details Buffers only ever grow, so once the largest layer has been extracted, no further scratch memory is allocated.
+/// A context must only be used by one thread at a time.
+/// \sa CreateDecodeContext DestroyDecodeContext
+struct DecodeContext
+{
+	void* buffers[decodeBuffer::COUNT];			///< The scratch buffers, or nullptr if a buffer has not been needed yet.
+	size_t sizes[decodeBuffer::COUNT];			///< The size of each scratch buffer.
+};
+
+PSD_NAMESPACE_END
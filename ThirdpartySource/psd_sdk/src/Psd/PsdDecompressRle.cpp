@@ -6,32 +6,188 @@
 
 #include "PsdAssert.h"
 #include "PsdLog.h"
+#include "PsdSimd.h"
 #include <cstring>
 
+#if PSD_USE_SSE && PSD_USE_MSVC
+	#include <intrin.h>
+#endif
+
 
 PSD_NAMESPACE_BEGIN
 
+namespace
+{
+	// a PackBits packet expands to at most 128 bytes, which is a whole number of chunks
+	static const ptrdiff_t MAX_PACKET_LENGTH = 128;
+	static const unsigned int CHUNK_SIZE = 16u;
+
+	// PackBits stores at most 128 bytes in a single run or literal packet
+	static const unsigned int MAX_RUN_LENGTH = 128u;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void CopyChunks(uint8_t* PSD_RESTRICT dest, const uint8_t* PSD_RESTRICT src, unsigned int count)
+	{
+		// copies count bytes rounded up to the next multiple of the chunk size
+		for (unsigned int i=0; i < count; i += CHUNK_SIZE)
+		{
+#if PSD_USE_SSE
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+#else
+			memcpy(dest + i, src + i, CHUNK_SIZE);
+#endif
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void FillChunks(uint8_t* PSD_RESTRICT dest, uint8_t value, unsigned int count)
+	{
+		// fills count bytes rounded up to the next multiple of the chunk size
+#if PSD_USE_SSE
+		const __m128i chunk = _mm_set1_epi8(static_cast<char>(value));
+		for (unsigned int i=0; i < count; i += CHUNK_SIZE)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), chunk);
+		}
+#else
+		uint8_t chunk[CHUNK_SIZE];
+		memset(chunk, value, CHUNK_SIZE);
+		for (unsigned int i=0; i < count; i += CHUNK_SIZE)
+		{
+			memcpy(dest + i, chunk, CHUNK_SIZE);
+		}
+#endif
+	}
+
+
+#if PSD_USE_SSE
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int CountTrailingZeros(uint32_t mask)
+	{
+		PSD_ASSERT(mask != 0u, "Mask must have at least one bit set.");
+
+#if PSD_USE_MSVC
+		unsigned long index = 0u;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE uint32_t CompareNeighbours(const uint8_t* src)
+	{
+		// returns a bit mask that has bit i set if src[i] == src[i-1], for 16 consecutive bytes
+		const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src - 1));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)));
+	}
+#endif
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool Equal>
+	PSD_INLINE unsigned int CountNeighbours(const uint8_t* src, unsigned int count)
+	{
+		// returns how many consecutive bytes, starting at src[0], either all match the byte preceding them (Equal == true),
+		// or all differ from the byte preceding them (Equal == false). never looks at more than count bytes.
+		unsigned int i = 0u;
+#if PSD_USE_SSE
+		for (; i + 32u <= count; i += 32u)
+		{
+			uint32_t mask = CompareNeighbours(src + i) | (CompareNeighbours(src + i + 16u) << 16u);
+			mask = Equal ? ~mask : mask;
+			if (mask != 0u)
+			{
+				return i + CountTrailingZeros(mask);
+			}
+		}
+
+		for (; i + 16u <= count; i += 16u)
+		{
+			uint32_t mask = CompareNeighbours(src + i);
+			mask = Equal ? (mask ^ 0xFFFFu) : mask;
+			if (mask != 0u)
+			{
+				return i + CountTrailingZeros(mask);
+			}
+		}
+#endif
+
+		const uint8_t* previous = src - 1;
+		for (; i < count; ++i)
+		{
+			if ((src[i] == previous[i]) != Equal)
+			{
+				break;
+			}
+		}
+
+		return i;
+	}
+}
+
+
 namespace imageUtil
 {
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	void DecompressRle(const uint8_t* PSD_RESTRICT src, unsigned int srcSize, uint8_t* PSD_RESTRICT dest, unsigned int size)
+	void DecompressRle(const uint8_t* PSD_RESTRICT src, size_t srcSize, uint8_t* PSD_RESTRICT dest, size_t size)
 	{
 		PSD_ASSERT_NOT_NULL(src);
 		PSD_ASSERT_NOT_NULL(dest);
 
-		unsigned int bytesRead = 0u;
-		unsigned int offset = 0u;
-		while (offset < size)
+		const uint8_t* srcEnd = src + srcSize;
+		uint8_t* destEnd = dest + size;
+
+		// as long as both buffers have room for the longest possible packet, runs and literals are written using whole chunks.
+		// the bytes written past the end of a packet are overwritten by the packets following it.
+		while ((destEnd - dest >= MAX_PACKET_LENGTH) && (srcEnd - src > MAX_PACKET_LENGTH))
+		{
+			const uint8_t byte = *src++;
+
+			// 0x81 - 0XFF
+			if (byte > 0x80)
+			{
+				// next 257-byte bytes are replicated from the next source byte
+				const unsigned int count = static_cast<unsigned int>(257 - byte);
+
+				FillChunks(dest, *src++, count);
+				dest += count;
+			}
+			// 0x00 - 0x7F
+			else if (byte < 0x80)
+			{
+				// copy next byte+1 bytes
+				const unsigned int count = static_cast<unsigned int>(byte + 1);
+
+				CopyChunks(dest, src, count);
+				src += count;
+				dest += count;
+			}
+
+			// byte == -128 (0x80) is a no-op
+		}
+
+		// decode the remaining packets while checking each of them against the end of both buffers
+		while (dest < destEnd)
 		{
-			if (bytesRead >= srcSize)
+			if (src >= srcEnd)
 			{
 				PSD_ERROR("DecompressRle", "Malformed RLE data encountered");
 				return;
 			}
 
 			const uint8_t byte = *src++;
-			++bytesRead;
 
 			if (byte == 0x80)
 			{
@@ -42,24 +198,29 @@ namespace imageUtil
 			{
 				// next 257-byte bytes are replicated from the next source byte
 				const unsigned int count = static_cast<unsigned int>(257 - byte);
+				if ((src >= srcEnd) || (count > static_cast<size_t>(destEnd - dest)))
+				{
+					PSD_ERROR("DecompressRle", "Malformed RLE data encountered");
+					return;
+				}
 
-				memset(dest + offset, *src++, count);
-				offset += count;
-
-				++bytesRead;
+				memset(dest, *src++, count);
+				dest += count;
 			}
 			// 0x00 - 0x7F
 			else
 			{
-				// copy next byte+1 bytes 1-by-1
+				// copy next byte+1 bytes
 				const unsigned int count = static_cast<unsigned int>(byte + 1);
-				
-				memcpy(dest + offset, src, count);
+				if ((count > static_cast<size_t>(srcEnd - src)) || (count > static_cast<size_t>(destEnd - dest)))
+				{
+					PSD_ERROR("DecompressRle", "Malformed RLE data encountered");
+					return;
+				}
 
+				memcpy(dest, src, count);
 				src += count;
-				offset += count;
-
-				bytesRead += count;
+				dest += count;
 			}
 		}
 	}
@@ -76,67 +237,84 @@ namespace imageUtil
 		unsigned int nonRunLength = 0u;
 
 		unsigned int rleDataSize = 0u;
-		for (unsigned int i = 1u; i < size; ++i)
+		unsigned int i = 1u;
+		while (i < size)
 		{
-			const uint8_t previous = src[i - 1];
-			const uint8_t current = src[i];
-			if (previous == current)
+			if (runLength != 0u)
 			{
-				if (nonRunLength != 0u)
-				{
-					// first repeat of a character
-
-					// write non-run bytes so far
-					*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
-					memcpy(dest, src + i - nonRunLength - 1u, nonRunLength);
-					dest += nonRunLength;
-					rleDataSize += 1u + nonRunLength;
-
-					nonRunLength = 0u;
-				}
-
-				// belongs to the same run
-				++runLength;
+				// skip all bytes that continue the current run, up to its maximum length
+				const unsigned int maxCount = MAX_RUN_LENGTH - runLength;
+				const unsigned int count = CountNeighbours<true>(src + i, (size - i < maxCount) ? (size - i) : maxCount);
+				runLength += count;
+				i += count;
 
 				// maximum length of a run is 128
-				if (runLength == 128u)
+				if (runLength == MAX_RUN_LENGTH)
 				{
 					// need to manually stop this run and write to output
 					*dest++ = static_cast<uint8_t>(257u - runLength);
-					*dest++ = current;
+					*dest++ = src[i - 1u];
 					rleDataSize += 2u;
 
 					runLength = 0u;
+					continue;
+				}
+
+				if (i == size)
+				{
+					break;
 				}
+
+				// src[i] differs from src[i - 1]. include first character and encode this run
+				++runLength;
+
+				*dest++ = static_cast<uint8_t>(257u - runLength);
+				*dest++ = src[i - 1u];
+				rleDataSize += 2u;
+
+				runLength = 0u;
+				++i;
 			}
 			else
 			{
-				if (runLength != 0u)
-				{
-					// include first character and encode this run
-					++runLength;
+				// skip all bytes that differ from their predecessor, up to the maximum length of a non-run
+				const unsigned int maxCount = MAX_RUN_LENGTH - nonRunLength;
+				const unsigned int count = CountNeighbours<false>(src + i, (size - i < maxCount) ? (size - i) : maxCount);
+				nonRunLength += count;
+				i += count;
 
-					*dest++ = static_cast<uint8_t>(257u - runLength);
-					*dest++ = previous;
-					rleDataSize += 2u;
+				// maximum length of a non-run is 128 bytes
+				if (nonRunLength == MAX_RUN_LENGTH)
+				{
+					*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
+					memcpy(dest, src + i - 1u - nonRunLength, nonRunLength);
+					dest += nonRunLength;
+					rleDataSize += 1u + nonRunLength;
 
-					runLength = 0u;
+					nonRunLength = 0u;
+					continue;
 				}
-				else
+
+				if (i == size)
 				{
-					++nonRunLength;
+					break;
 				}
 
-				// maximum length of a non-run is 128 bytes
-				if (nonRunLength == 128u)
+				// src[i] is the first repeat of a character
+				if (nonRunLength != 0u)
 				{
+					// write non-run bytes so far
 					*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
-					memcpy(dest, src + i - nonRunLength, nonRunLength);
+					memcpy(dest, src + i - nonRunLength - 1u, nonRunLength);
 					dest += nonRunLength;
 					rleDataSize += 1u + nonRunLength;
 
 					nonRunLength = 0u;
 				}
+
+				// belongs to the same run
+				++runLength;
+				++i;
 			}
 		}
 
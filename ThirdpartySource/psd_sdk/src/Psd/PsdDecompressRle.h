@@ -10,7 +10,8 @@ namespace imageUtil
 {
 	/// \ingroup ImageUtil
 	/// Decompresses a block of RLE encoded data using the PackBits (http://en.wikipedia.org/wiki/PackBits) algorithm.
-	void DecompressRle(const uint8_t* PSD_RESTRICT src, unsigned int srcSize, uint8_t* PSD_RESTRICT dest, unsigned int size);
+	/// Never reads more than \a srcSize bytes from \a src and never writes more than \a size bytes to \a dest, even for malformed data.
+	void DecompressRle(const uint8_t* PSD_RESTRICT src, size_t srcSize, uint8_t* PSD_RESTRICT dest, size_t size);
 
 	/// \ingroup ImageUtil
 	/// Compresses a block of data to RLE encoded data using the PackBits (http://en.wikipedia.org/wiki/PackBits) algorithm.
@@ -10,10 +10,11 @@ PSD_NAMESPACE_BEGIN
 
 /// \ingroup Types
 /// \class Document
-/// \brief A struct storing the document-wide information and sections contained in a .PSD file.
+/// \brief A struct storing the document-wide information and sections contained in a .PSD or .PSB file.
 /// \sa Section
 struct Document
 {
+	unsigned int version;						///< The file format version, 1 for .PSD files and 2 for .PSB files (Large Document Format).
 	unsigned int width;							///< The width of the document.
 	unsigned int height;						///< The height of the document.
 	unsigned int channelCount;					///< The number of channels stored in the document, including any additional alpha channels.
@@ -0,0 +1,205 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdEndianConversion.h"
+
+#include "PsdSimd.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+#if PSD_USE_AVX2
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_TARGET_AVX2 static size_t SwapBytesAVX2(const uint8_t* src, uint8_t* dest, size_t size, __m256i shuffle)
+	{
+		const size_t blockCount = size / sizeof(__m256i);
+		for (size_t i=0; i < blockCount; ++i)
+		{
+			const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i*sizeof(__m256i)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i*sizeof(__m256i)), _mm256_shuffle_epi8(value, shuffle));
+		}
+
+		return blockCount*sizeof(__m256i);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_TARGET_AVX2 static size_t SwapBytes16AVX2(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+		return SwapBytesAVX2(src, dest, size, shuffle);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_TARGET_AVX2 static size_t SwapBytes32AVX2(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+		return SwapBytesAVX2(src, dest, size, shuffle);
+	}
+#endif
+
+
+#if PSD_USE_SSE
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE __m128i SwapBytes16(__m128i value)
+	{
+		// SSE2 has no byte shuffle, but swapping the bytes of a 16-bit value is a rotation by 8 bits
+		return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE __m128i SwapBytes32(__m128i value)
+	{
+		// swap the 16-bit halves of each 32-bit value first, and then the bytes of each half
+		const __m128i swappedHalves = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+		return SwapBytes16(swappedHalves);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t SwapBytes16SSE(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const size_t blockCount = size / sizeof(__m128i);
+		for (size_t i=0; i < blockCount; ++i)
+		{
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*sizeof(__m128i)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i*sizeof(__m128i)), SwapBytes16(value));
+		}
+
+		return blockCount*sizeof(__m128i);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t SwapBytes32SSE(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const size_t blockCount = size / sizeof(__m128i);
+		for (size_t i=0; i < blockCount; ++i)
+		{
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*sizeof(__m128i)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i*sizeof(__m128i)), SwapBytes32(value));
+		}
+
+		return blockCount*sizeof(__m128i);
+	}
+#endif
+
+
+#if PSD_USE_NEON
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t SwapBytes16NEON(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const size_t blockCount = size / 16u;
+		for (size_t i=0; i < blockCount; ++i)
+		{
+			vst1q_u8(dest + i*16u, vrev16q_u8(vld1q_u8(src + i*16u)));
+		}
+
+		return blockCount*16u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t SwapBytes32NEON(const uint8_t* src, uint8_t* dest, size_t size)
+	{
+		const size_t blockCount = size / 16u;
+		for (size_t i=0; i < blockCount; ++i)
+		{
+			vst1q_u8(dest + i*16u, vrev32q_u8(vld1q_u8(src + i*16u)));
+		}
+
+		return blockCount*16u;
+	}
+#endif
+}
+
+
+namespace endianUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void SwapBytes16(const void* src, void* dest, size_t count)
+	{
+		const uint8_t* srcBytes = static_cast<const uint8_t*>(src);
+		uint8_t* destBytes = static_cast<uint8_t*>(dest);
+		const size_t size = count*sizeof(uint16_t);
+
+		// swap whole blocks using the widest instruction set available first
+		size_t done = 0u;
+#if PSD_USE_AVX2
+		if (simdUtil::HasAvx2())
+		{
+			done = SwapBytes16AVX2(srcBytes, destBytes, size);
+		}
+#endif
+
+#if PSD_USE_SSE
+		done += SwapBytes16SSE(srcBytes + done, destBytes + done, size - done);
+#elif PSD_USE_NEON
+		done += SwapBytes16NEON(srcBytes + done, destBytes + done, size - done);
+#endif
+
+		for (size_t i = done; i < size; i += sizeof(uint16_t))
+		{
+			uint16_t value;
+			memcpy(&value, srcBytes + i, sizeof(uint16_t));
+			value = BigEndianToNative(value);
+			memcpy(destBytes + i, &value, sizeof(uint16_t));
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void SwapBytes32(const void* src, void* dest, size_t count)
+	{
+		const uint8_t* srcBytes = static_cast<const uint8_t*>(src);
+		uint8_t* destBytes = static_cast<uint8_t*>(dest);
+		const size_t size = count*sizeof(uint32_t);
+
+		// swap whole blocks using the widest instruction set available first
+		size_t done = 0u;
+#if PSD_USE_AVX2
+		if (simdUtil::HasAvx2())
+		{
+			done = SwapBytes32AVX2(srcBytes, destBytes, size);
+		}
+#endif
+
+#if PSD_USE_SSE
+		done += SwapBytes32SSE(srcBytes + done, destBytes + done, size - done);
+#elif PSD_USE_NEON
+		done += SwapBytes32NEON(srcBytes + done, destBytes + done, size - done);
+#endif
+
+		for (size_t i = done; i < size; i += sizeof(uint32_t))
+		{
+			uint32_t value;
+			memcpy(&value, srcBytes + i, sizeof(uint32_t));
+			value = BigEndianToNative(value);
+			memcpy(destBytes + i, &value, sizeof(uint32_t));
+		}
+	}
+}
+
+PSD_NAMESPACE_END
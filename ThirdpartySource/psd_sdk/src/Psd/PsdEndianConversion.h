@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cstdlib>
+#include <cstring>
 
 
 PSD_NAMESPACE_BEGIN
@@ -28,6 +29,26 @@ namespace endianUtil
 	/// Converts from native-endian to little-endian, and returns the converted value.
 	template <typename T>
 	PSD_INLINE T NativeToLittleEndian(T value);
+
+	/// Reads a big-endian value from possibly unaligned memory, and returns the value converted to native-endian.
+	template <typename T>
+	PSD_INLINE T ReadBigEndian(const void* src);
+
+	/// Swaps the bytes of \a count 16-bit values read from \a src, and stores them in \a dest. Both buffers can be the same.
+	/// \remark Uses AVX2, SSE2 or NEON instructions where available, and has no alignment requirements.
+	void SwapBytes16(const void* src, void* dest, size_t count);
+
+	/// Swaps the bytes of \a count 32-bit values read from \a src, and stores them in \a dest. Both buffers can be the same.
+	/// \remark Uses AVX2, SSE2 or NEON instructions where available, and has no alignment requirements.
+	void SwapBytes32(const void* src, void* dest, size_t count);
+
+	/// Converts \a count values read from \a src from big-endian to native-endian, and stores them in \a dest. Both buffers can be the same.
+	template <typename T>
+	inline void BigEndianToNativeArray(const T* src, T* dest, size_t count);
+
+	/// Converts \a count values read from \a src from native-endian to big-endian, and stores them in \a dest. Both buffers can be the same.
+	template <typename T>
+	inline void NativeToBigEndianArray(const T* src, T* dest, size_t count);
 }
 
 #include "PsdEndianConversion.inl"
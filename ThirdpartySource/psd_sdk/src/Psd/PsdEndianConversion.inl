@@ -150,6 +150,66 @@ namespace endianUtil
 	{
 		return LittleEndianToNative(value);
 	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	PSD_INLINE T ReadBigEndian(const void* src)
+	{
+		T value;
+		memcpy(&value, src, sizeof(T));
+
+		return BigEndianToNative(value);
+	}
+
+
+	namespace internal
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <size_t N>
+		inline void SwapBytesArray(const void* src, void* dest, size_t count);
+
+		template <>
+		inline void SwapBytesArray<1u>(const void* src, void* dest, size_t count)
+		{
+			if (src != dest)
+			{
+				memmove(dest, src, count);
+			}
+		}
+
+		template <>
+		inline void SwapBytesArray<2u>(const void* src, void* dest, size_t count)
+		{
+			SwapBytes16(src, dest, count);
+		}
+
+		template <>
+		inline void SwapBytesArray<4u>(const void* src, void* dest, size_t count)
+		{
+			SwapBytes32(src, dest, count);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	inline void BigEndianToNativeArray(const T* src, T* dest, size_t count)
+	{
+		internal::SwapBytesArray<sizeof(T)>(src, dest, count);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	inline void NativeToBigEndianArray(const T* src, T* dest, size_t count)
+	{
+		internal::SwapBytesArray<sizeof(T)>(src, dest, count);
+	}
 }
 
 
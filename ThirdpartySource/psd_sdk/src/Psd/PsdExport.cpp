@@ -14,8 +14,10 @@
 #include "PsdChannelType.h"
 #include "PsdBitUtil.h"
 #include "PsdThumbnail.h"
+#include "PsdThreadUtil.h"
 #include "Psdminiz.h"
 #include <string.h>
+#include <algorithm>
 
 
 PSD_NAMESPACE_BEGIN
@@ -72,6 +74,28 @@ namespace
 	}
 
 
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void FreeChannelData(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex)
+	{
+		const uint16_t compression = layer->channelCompression[channelIndex];
+		void*& data = layer->channelData[channelIndex];
+		if ((compression == compressionType::ZIP) ||
+			(compression == compressionType::ZIP_WITH_PREDICTION))
+		{
+			// data was allocated by miniz
+			free(data);
+		}
+		else
+		{
+			memoryUtil::FreeArray(allocator, data);
+		}
+		data = nullptr;
+
+		memoryUtil::FreeArray(allocator, layer->pendingData[channelIndex]);
+	}
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	static uint16_t GetChannelCount(ExportLayer* layer)
@@ -344,6 +368,8 @@ ExportDocument* CreateExportDocument(Allocator* allocator, unsigned int canvasWi
 
 	document->thumbnail = nullptr;
 
+	document->compressionThreadCount = 1u;
+
 	return document;
 }
 
@@ -385,19 +411,7 @@ void DestroyExportDocument(ExportDocument*& document, Allocator* allocator)
 
 		for (unsigned int j = 0u; j < ExportLayer::MAX_CHANNEL_COUNT; ++j)
 		{
-			const uint16_t compression = document->layers[i].channelCompression[j];
-			void*& data = document->layers[i].channelData[j];
-			if ((compression == compressionType::ZIP) ||
-				(compression == compressionType::ZIP_WITH_PREDICTION))
-			{
-				// data was allocated by miniz
-				free(data);
-			}
-			else
-			{
-				memoryUtil::FreeArray(allocator, data);
-			}
-			data = nullptr;
+			FreeChannelData(allocator, document->layers + i, j);
 		}
 	}
 
@@ -406,6 +420,14 @@ void DestroyExportDocument(ExportDocument*& document, Allocator* allocator)
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void SetCompressionThreadCount(ExportDocument* document, unsigned int threadCount)
+{
+	document->compressionThreadCount = threadCount;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 unsigned int AddMetaData(ExportDocument* document, Allocator* allocator, const char* name, const char* value)
@@ -498,10 +520,7 @@ static void CreateDataRaw(Allocator* allocator, ExportLayer* layer, unsigned int
 	const uint32_t size = width*height;
 
 	T* bigEndianData = memoryUtil::AllocateArray<T>(allocator, size);
-	for (unsigned int i = 0u; i < size; ++i)
-	{
-		bigEndianData[i] = endianUtil::NativeToBigEndian(planarData[i]);
-	}
+	endianUtil::NativeToBigEndianArray(planarData, bigEndianData, size);
 
 	layer->channelData[channelIndex] = bigEndianData;
 	layer->channelSize[channelIndex] = size*sizeof(T);
@@ -524,10 +543,7 @@ static void CreateDataRLE(Allocator* allocator, ExportLayer* layer, unsigned int
 	unsigned int offset = 0u;
 	for (unsigned int y = 0u; y < height; ++y)
 	{
-		for (unsigned int x = 0u; x < width; ++x)
-		{
-			bigEndianRowData[x] = endianUtil::NativeToBigEndian(planarData[y*width + x]);
-		}
+		endianUtil::NativeToBigEndianArray(planarData + y*width, bigEndianRowData, width);
 
 		const unsigned int compressedSize = imageUtil::CompressRle(reinterpret_cast<const uint8_t*>(bigEndianRowData), rleRowData, width*sizeof(T));
 		PSD_ASSERT(compressedSize <= width*sizeof(T) * 2u, "RLE compressed data doesn't fit into provided buffer.");
@@ -572,10 +588,7 @@ static void CreateDataZipPrediction(Allocator* allocator, ExportLayer* layer, un
 	}
 
 	// convert to big endian
-	for (unsigned int i = 0u; i < size; ++i)
-	{
-		allocation[i] = endianUtil::NativeToBigEndian(allocation[i]);
-	}
+	endianUtil::NativeToBigEndianArray(allocation, allocation, size);
 
 	size_t zipDataSize = 0u;
 	void* zipData = tdefl_compress_mem_to_heap(allocation, size*sizeof(T), &zipDataSize, TDEFL_WRITE_ZLIB_HEADER);
@@ -645,10 +658,7 @@ static void CreateDataZip(Allocator* allocator, ExportLayer* layer, unsigned int
 	const uint32_t size = width*height;
 
 	T* bigEndianData = memoryUtil::AllocateArray<T>(allocator, size);
-	for (unsigned int i = 0u; i < size; ++i)
-	{
-		bigEndianData[i] = endianUtil::NativeToBigEndian(planarData[i]);
-	}
+	endianUtil::NativeToBigEndianArray(planarData, bigEndianData, size);
 
 	size_t zipDataSize = 0u;
 	void* zipData = tdefl_compress_mem_to_heap(bigEndianData, size*sizeof(T), &zipDataSize, TDEFL_WRITE_ZLIB_HEADER);
@@ -672,6 +682,102 @@ void CreateDataZip<float32_t>(Allocator* allocator, ExportLayer* layer, unsigned
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static void CreateData(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height)
+{
+	const uint16_t compression = layer->channelCompression[channelIndex];
+	if (compression == compressionType::RAW)
+	{
+		// raw data, copy directly and convert to big endian
+		CreateDataRaw(allocator, layer, channelIndex, planarData, width, height);
+	}
+	else if (compression == compressionType::RLE)
+	{
+		// compress with RLE
+		CreateDataRLE(allocator, layer, channelIndex, planarData, width, height);
+	}
+	else if (compression == compressionType::ZIP)
+	{
+		// compress with ZIP
+		// note that this has a template specialization for 32-bit float data that forwards to ZipWithPrediction.
+		CreateDataZip(allocator, layer, channelIndex, planarData, width, height);
+	}
+	else if (compression == compressionType::ZIP_WITH_PREDICTION)
+	{
+		// delta-encode, then compress with ZIP
+		CreateDataZipPrediction(allocator, layer, channelIndex, planarData, width, height);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static void CreatePendingData(ExportDocument* document, Allocator* allocator, ExportLayer* layer, unsigned int channelIndex)
+{
+	const void* planarData = layer->pendingData[channelIndex];
+	const uint32_t width = layer->pendingWidth[channelIndex];
+	const uint32_t height = layer->pendingHeight[channelIndex];
+	if (document->bitsPerChannel == 8u)
+	{
+		CreateData(allocator, layer, channelIndex, static_cast<const uint8_t*>(planarData), width, height);
+	}
+	else if (document->bitsPerChannel == 16u)
+	{
+		CreateData(allocator, layer, channelIndex, static_cast<const uint16_t*>(planarData), width, height);
+	}
+	else if (document->bitsPerChannel == 32u)
+	{
+		CreateData(allocator, layer, channelIndex, static_cast<const float32_t*>(planarData), width, height);
+	}
+
+	memoryUtil::FreeArray(allocator, layer->pendingData[channelIndex]);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static void CreateAllPendingData(ExportDocument* document, Allocator* allocator)
+{
+	static const unsigned int MAX_PENDING_COUNT = ExportDocument::MAX_LAYER_COUNT * ExportLayer::MAX_CHANNEL_COUNT;
+
+	unsigned int* pending = memoryUtil::AllocateArray<unsigned int>(allocator, MAX_PENDING_COUNT);
+	uint64_t* sizes = memoryUtil::AllocateArray<uint64_t>(allocator, MAX_PENDING_COUNT);
+	unsigned int count = 0u;
+	for (unsigned int i = 0u; i < document->layerCount; ++i)
+	{
+		const ExportLayer* layer = document->layers + i;
+		for (unsigned int j = 0u; j < ExportLayer::MAX_CHANNEL_COUNT; ++j)
+		{
+			if (layer->pendingData[j])
+			{
+				const unsigned int index = i*ExportLayer::MAX_CHANNEL_COUNT + j;
+				pending[count++] = index;
+				sizes[index] = static_cast<uint64_t>(layer->pendingWidth[j]) * layer->pendingHeight[j];
+			}
+		}
+	}
+
+	// compress the largest channels first, so that one huge channel does not end up being compressed
+	// by a single thread at the very end, while all other threads are already idle.
+	std::stable_sort(pending, pending + count, [sizes](unsigned int a, unsigned int b)
+	{
+		return sizes[a] > sizes[b];
+	});
+
+	// each task only touches the data of its own channel
+	threadUtil::ParallelFor(count, document->compressionThreadCount, [=](unsigned int i)
+	{
+		ExportLayer* layer = document->layers + pending[i] / ExportLayer::MAX_CHANNEL_COUNT;
+		CreatePendingData(document, allocator, layer, pending[i] % ExportLayer::MAX_CHANNEL_COUNT);
+	});
+
+	memoryUtil::FreeArray(allocator, sizes);
+	memoryUtil::FreeArray(allocator, pending);
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
@@ -690,23 +796,7 @@ void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned in
 	const unsigned int channelIndex = GetChannelIndex(channel);
 
 	// free old data
-	{
-		void* data = layer->channelData[channelIndex];
-		if (data)
-		{
-			const uint16_t type = layer->channelCompression[channelIndex];
-			if ((type == compressionType::ZIP) ||
-				(type == compressionType::ZIP_WITH_PREDICTION))
-			{
-				// data was allocated by miniz
-				free(data);
-			}
-			else
-			{
-				memoryUtil::FreeArray(allocator, data);
-			}
-		}
-	}
+	FreeChannelData(allocator, layer, channelIndex);
 
 	// prepare new data
 	layer->top = top;
@@ -720,27 +810,19 @@ void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned in
 	const uint32_t width = static_cast<uint32_t>(right - left);
 	const uint32_t height = static_cast<uint32_t>(bottom - top);
 
-	if (compression == compressionType::RAW)
-	{
-		// raw data, copy directly and convert to big endian
-		CreateDataRaw(allocator, layer, channelIndex, planarData, width, height);
-	}
-	else if (compression == compressionType::RLE)
+	if (document->compressionThreadCount != 1u)
 	{
-		// compress with RLE
-		CreateDataRLE(allocator, layer, channelIndex, planarData, width, height);
-	}
-	else if (compression == compressionType::ZIP)
-	{
-		// compress with ZIP
-		// note that this has a template specialization for 32-bit float data that forwards to ZipWithPrediction.
-		CreateDataZip(allocator, layer, channelIndex, planarData, width, height);
-	}
-	else if (compression == compressionType::ZIP_WITH_PREDICTION)
-	{
-		// delta-encode, then compress with ZIP
-		CreateDataZipPrediction(allocator, layer, channelIndex, planarData, width, height);
+		// keep a copy of the data, it is compressed together with all other channels in WriteDocument
+		T* pendingData = memoryUtil::AllocateArray<T>(allocator, width*height);
+		memcpy(pendingData, planarData, width*height*sizeof(T));
+
+		layer->pendingData[channelIndex] = pendingData;
+		layer->pendingWidth[channelIndex] = width;
+		layer->pendingHeight[channelIndex] = height;
+		return;
 	}
+
+	CreateData(allocator, layer, channelIndex, planarData, width, height);
 }
 
 
@@ -802,10 +884,7 @@ void UpdateChannelImpl(ExportDocument* document, Allocator* allocator, unsigned
 	// copy raw data
 	const uint32_t size = document->width*document->height;
 	T* channelData = memoryUtil::AllocateArray<T>(allocator, size);
-	for (unsigned int i = 0u; i < size; ++i)
-	{
-		channelData[i] = endianUtil::NativeToBigEndian(data[i]);
-	}
+	endianUtil::NativeToBigEndianArray(data, channelData, size);
 	document->alphaChannelData[channelIndex] = channelData;
 }
 
@@ -849,12 +928,9 @@ void UpdateMergedImageImpl(ExportDocument* document, Allocator* allocator, const
 	T* memoryR = memoryUtil::AllocateArray<T>(allocator, size);
 	T* memoryG = memoryUtil::AllocateArray<T>(allocator, size);
 	T* memoryB = memoryUtil::AllocateArray<T>(allocator, size);
-	for (unsigned int i = 0u; i < size; ++i)
-	{
-		memoryR[i] = endianUtil::NativeToBigEndian(planarDataR[i]);
-		memoryG[i] = endianUtil::NativeToBigEndian(planarDataG[i]);
-		memoryB[i] = endianUtil::NativeToBigEndian(planarDataB[i]);
-	}
+	endianUtil::NativeToBigEndianArray(planarDataR, memoryR, size);
+	endianUtil::NativeToBigEndianArray(planarDataG, memoryG, size);
+	endianUtil::NativeToBigEndianArray(planarDataB, memoryB, size);
 	document->mergedImageData[0] = memoryR;
 	document->mergedImageData[1] = memoryG;
 	document->mergedImageData[2] = memoryB;
@@ -889,6 +965,9 @@ void UpdateMergedImage(ExportDocument* document, Allocator* allocator, const flo
 // ---------------------------------------------------------------------------------------------------------------------
 void WriteDocument(ExportDocument* document, Allocator* allocator, File* file)
 {
+	// compress the channel data that was deferred by UpdateLayer, so that all sizes are known up front
+	CreateAllPendingData(document, allocator);
+
 	SyncFileWriter writer(file);
 
 	// signature
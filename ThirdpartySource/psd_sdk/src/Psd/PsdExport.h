@@ -26,6 +26,15 @@ ExportDocument* CreateExportDocument(Allocator* allocator, unsigned int canvasWi
 void DestroyExportDocument(ExportDocument*& document, Allocator* allocator);
 
 
+/// \ingroup Exporter
+/// Sets the number of threads used for compressing layer channel data, including the calling thread. With the default of 1,
+/// channel data is compressed on the calling thread inside \ref UpdateLayer. Any other count makes \ref UpdateLayer store a copy
+/// of the uncompressed data instead, and \ref WriteDocument compresses the channels of all layers concurrently before writing them.
+/// A \a threadCount of 0 uses all hardware threads.
+/// \remark When compressing concurrently, the allocator passed to \ref WriteDocument is used from multiple threads and must therefore be thread-safe.
+void SetCompressionThreadCount(ExportDocument* document, unsigned int threadCount);
+
+
 /// \ingroup Exporter
 /// Adds meta data to a document. The contents of \a name and \a value are copied. The returned index can be used to update existing meta data
 /// by a call to \ref UpdateMetaData.
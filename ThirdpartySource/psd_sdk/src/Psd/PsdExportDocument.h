@@ -46,6 +46,8 @@ struct ExportDocument
 	uint32_t sizeOfExifData;
 
 	Thumbnail* thumbnail;
+
+	unsigned int compressionThreadCount;
 };
 
 PSD_NAMESPACE_END
@@ -23,6 +23,11 @@ struct ExportLayer
 	void* channelData[MAX_CHANNEL_COUNT];
 	uint32_t channelSize[MAX_CHANNEL_COUNT];
 	uint16_t channelCompression[MAX_CHANNEL_COUNT];
+
+	// uncompressed planar data whose compression is deferred to WriteDocument, see SetCompressionThreadCount
+	void* pendingData[MAX_CHANNEL_COUNT];
+	uint32_t pendingWidth[MAX_CHANNEL_COUNT];
+	uint32_t pendingHeight[MAX_CHANNEL_COUNT];
 };
 
 PSD_NAMESPACE_END
@@ -3,11 +3,23 @@
 
 #include "PsdPch.h"
 #include "PsdFile.h"
+#include "PsdAllocator.h"
 #include "PsdAssert.h"
+#include "PsdMemoryUtil.h"
 
 
 PSD_NAMESPACE_BEGIN
 
+namespace
+{
+	struct DefaultBatch
+	{
+		File::ReadOperation* operations;
+		unsigned int count;
+	};
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 File::File(Allocator* allocator)
@@ -70,6 +82,24 @@ bool File::WaitForRead(File::ReadOperation& operation)
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::BatchOperation File::ReadBatch(const ReadRequest* requests, unsigned int count)
+{
+	PSD_ASSERT_NOT_NULL(requests);
+
+	return DoReadBatch(requests, count);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool File::WaitForBatch(File::BatchOperation& operation)
+{
+	return DoWaitForBatch(operation);
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 File::WriteOperation File::Write(const void* buffer, uint32_t count, uint64_t position)
@@ -95,4 +125,59 @@ uint64_t File::GetSize(void) const
 	return DoGetSize();
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* File::GetData(uint64_t position, uint64_t count) const
+{
+	return DoGetData(position, count);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* File::DoGetData(uint64_t, uint64_t) const
+{
+	return nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::BatchOperation File::DoReadBatch(const ReadRequest* requests, unsigned int count)
+{
+	// issue all reads before waiting for any of them, so that asynchronous implementations can overlap them
+	DefaultBatch* batch = memoryUtil::Allocate<DefaultBatch>(m_allocator);
+	batch->operations = memoryUtil::AllocateArray<ReadOperation>(m_allocator, count);
+	batch->count = count;
+
+	for (unsigned int i=0; i < count; ++i)
+	{
+		PSD_ASSERT_NOT_NULL(requests[i].buffer);
+		batch->operations[i] = DoRead(requests[i].buffer, requests[i].count, requests[i].position);
+	}
+
+	return batch;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool File::DoWaitForBatch(BatchOperation& operation)
+{
+	DefaultBatch* batch = static_cast<DefaultBatch*>(operation);
+
+	bool success = true;
+	for (unsigned int i=0; i < batch->count; ++i)
+	{
+		success &= DoWaitForRead(batch->operations[i]);
+	}
+
+	memoryUtil::FreeArray(m_allocator, batch->operations);
+	memoryUtil::Free(m_allocator, batch);
+	operation = nullptr;
+
+	return success;
+}
+
 PSD_NAMESPACE_END
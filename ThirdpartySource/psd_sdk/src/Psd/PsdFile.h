@@ -26,6 +26,17 @@ public:
 	/// A type representing an object associated with a write operation.
 	typedef void* WriteOperation;
 
+	/// A type representing an object associated with a batch of read operations.
+	typedef void* BatchOperation;
+
+	/// \brief A single read of a batch, see ReadBatch().
+	struct ReadRequest
+	{
+		void* buffer;				///< The buffer to read into.
+		uint32_t count;				///< The number of bytes to read.
+		uint64_t position;			///< The position in the file to read from.
+	};
+
 	/// Constructor.
 	explicit File(Allocator* allocator);
 
@@ -48,6 +59,15 @@ public:
 	/// Waits until the read operation associated with the given object is finished, and deletes its internal resources.
 	bool WaitForRead(ReadOperation& operation);
 
+	/// Asynchronously issues all \a count reads described by \a requests at once. Implementations are free to coalesce
+	/// requests for adjacent ranges, and to overlap the individual reads.
+	/// The returned BatchOperation must be used in a call to WaitForBatch() in order to free resources associated with it.
+	BatchOperation ReadBatch(const ReadRequest* requests, unsigned int count);
+
+	/// Waits until all reads of the batch associated with the given object are finished, and deletes its internal resources.
+	/// Returns whether all reads were successful.
+	bool WaitForBatch(BatchOperation& operation);
+
 	/// Asynchronously writes count bytes from the buffer, writing to position in the file.
 	/// The returned WriteOperation must be used in a call to WaitForWrite() in order to free resources associated with it.
 	WriteOperation Write(const void* buffer, uint32_t count, uint64_t position);
@@ -59,7 +79,16 @@ public:
 	/// If the function fails, 0 will be returned.
 	uint64_t GetSize(void) const;
 
+	/// Returns a pointer to \a count bytes of the file's contents starting at \a position, if the implementation holds the contents
+	/// directly in memory, e.g. because the file is memory-mapped. Returns a nullptr otherwise, or if the range lies outside the file.
+	/// The returned pointer stays valid until the file is closed, and can be used to read data without an intermediate copy.
+	const void* GetData(uint64_t position, uint64_t count) const;
+
 protected:
+	// default implementations that issue one read per request, available to derived classes as a fallback
+	virtual BatchOperation DoReadBatch(const ReadRequest* requests, unsigned int count);
+	virtual bool DoWaitForBatch(BatchOperation& operation);
+
 	Allocator* m_allocator;
 
 private:
@@ -74,6 +103,9 @@ private:
 	virtual bool DoWaitForWrite(WriteOperation& operation) PSD_ABSTRACT;
 
 	virtual uint64_t DoGetSize(void) const PSD_ABSTRACT;
+
+	// optional, only implemented by files whose contents are accessible in memory
+	virtual const void* DoGetData(uint64_t position, uint64_t count) const;
 };
 
 PSD_NAMESPACE_END
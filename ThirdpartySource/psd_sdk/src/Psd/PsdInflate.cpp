@@ -0,0 +1,1276 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInflate.h"
+
+#include "PsdAllocator.h"
+#include "PsdAllocationTag.h"
+#include "PsdAssert.h"
+#include "PsdSimd.h"
+#if PSD_USE_MINIZ_INFLATE
+	#include "Psdminiz.h"
+#endif
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+#if !PSD_USE_MINIZ_INFLATE
+namespace
+{
+	// codewords are looked up in a main table that is indexed by the next bits of the stream.
+	// longer codewords continue in a subtable, which is stored behind the main table.
+	static const unsigned int LITLEN_TABLE_BITS = 11u;
+	static const unsigned int DISTANCE_TABLE_BITS = 8u;
+	static const unsigned int PRECODE_TABLE_BITS = 7u;
+
+	static const unsigned int MAX_CODEWORD_LENGTH = 15u;
+	static const unsigned int LITLEN_SYMBOL_COUNT = 288u;
+	static const unsigned int DISTANCE_SYMBOL_COUNT = 32u;
+	static const unsigned int PRECODE_SYMBOL_COUNT = 19u;
+
+	// subtables only exist for complete subtrees of at least two codewords, so there are at most half as many subtables
+	// as there are symbols, each holding at most 2^(15 - main table bits) entries.
+	static const unsigned int LITLEN_TABLE_SIZE = (1u << LITLEN_TABLE_BITS) + (LITLEN_SYMBOL_COUNT / 2u) * (1u << (MAX_CODEWORD_LENGTH - LITLEN_TABLE_BITS));
+	static const unsigned int DISTANCE_TABLE_SIZE = (1u << DISTANCE_TABLE_BITS) + (DISTANCE_SYMBOL_COUNT / 2u) * (1u << (MAX_CODEWORD_LENGTH - DISTANCE_TABLE_BITS));
+	static const unsigned int PRECODE_TABLE_SIZE = 1u << PRECODE_TABLE_BITS;
+
+	// matches are copied in whole words where possible, and a single match never expands to more than 258 bytes.
+	// symbols are decoded without checking the end of the output as long as there is room for three pairs of literals,
+	// followed by the longest match including the excess bytes of a word copy.
+	static const size_t WORD_SIZE = 8u;
+	static const size_t MAX_MATCH_LENGTH = 258u;
+	static const size_t FAST_OUTPUT_MARGIN = 3u*2u + MAX_MATCH_LENGTH + WORD_SIZE;
+
+	// incremental inflation decodes into a buffer holding the 32 KB window that matches can refer to, followed by up to
+	// 32 KB of new data. the margin behind them allows symbols to be decoded without checking the end of the buffer.
+	static const size_t WINDOW_SIZE = 32768u;
+	static const size_t INFLATE_BUFFER_SIZE = 2u*WINDOW_SIZE + FAST_OUTPUT_MARGIN;
+
+	// the sums of the Adler-32 checksum cannot overflow 32 bits for up to 5552 bytes
+	static const uint32_t ADLER_MODULUS = 65521u;
+	static const size_t ADLER_BLOCK_SIZE = 5552u;
+
+	static const uint16_t LENGTH_BASE[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+
+	static const uint8_t LENGTH_EXTRA_BITS[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	static const uint16_t DISTANCE_BASE[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+
+	static const uint8_t DISTANCE_EXTRA_BITS[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// the order in which the codeword lengths of the precode are stored
+	static const uint8_t PRECODE_ORDER[PRECODE_SYMBOL_COUNT] =
+	{
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+
+
+	// each table entry stores the number of bits to consume in bits 0-5, flags in bits 8-11, the number of extra bits
+	// (or subtable bits, or literals) in bits 12-15, and the literals, base value or subtable offset in bits 16-31.
+	// keeping bits 6-7 clear allows the bit count to be used as shift amount directly.
+	namespace entryFlag
+	{
+		enum Enum
+		{
+			LITERAL = 0x100u,
+			SUBTABLE = 0x200u,
+			END_OF_BLOCK = 0x400u,
+			INVALID = 0x800u
+		};
+	}
+
+
+	namespace blockResult
+	{
+		enum Enum
+		{
+			END_OF_BLOCK,
+			SUSPENDED,				///< The output reached the point at which decoding is suspended.
+			INVALID
+		};
+	}
+
+
+	namespace blockState
+	{
+		enum Enum
+		{
+			HEADER,
+			STORED,
+			HUFFMAN,
+			CHECKSUM
+		};
+	}
+
+
+	/// Holds the decoding tables of a single block.
+	struct HuffmanTables
+	{
+		uint32_t litlen[LITLEN_TABLE_SIZE];
+		uint32_t distance[DISTANCE_TABLE_SIZE];
+	};
+
+
+	/// Reads the stream least significant bit first, and refills a 64-bit buffer with as many whole bytes as fit.
+	struct BitStream
+	{
+		const uint8_t* next;
+		const uint8_t* end;
+		uint64_t buffer;
+		unsigned int bitCount;
+		unsigned int overrunCount;			///< The number of zero bytes that were appended past the end of the stream.
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE uint32_t MakeEntry(unsigned int value, unsigned int extraBits, uint32_t flags)
+	{
+		return (static_cast<uint32_t>(value) << 16u) | (extraBits << 12u) | flags;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int GetBitCount(uint32_t entry)
+	{
+		return entry & 0x3Fu;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int GetExtraBitCount(uint32_t entry)
+	{
+		return (entry >> 12u) & 0x0Fu;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int GetValue(uint32_t entry)
+	{
+		return entry >> 16u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t GetLitlenEntry(unsigned int symbol)
+	{
+		if (symbol < 256u)
+		{
+			return MakeEntry(symbol, 1u, entryFlag::LITERAL);
+		}
+		else if (symbol == 256u)
+		{
+			return MakeEntry(0u, 0u, entryFlag::END_OF_BLOCK);
+		}
+		else if (symbol < 286u)
+		{
+			return MakeEntry(LENGTH_BASE[symbol - 257u], LENGTH_EXTRA_BITS[symbol - 257u], 0u);
+		}
+
+		return MakeEntry(0u, 0u, entryFlag::INVALID);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t GetDistanceEntry(unsigned int symbol)
+	{
+		if (symbol < 30u)
+		{
+			return MakeEntry(DISTANCE_BASE[symbol], DISTANCE_EXTRA_BITS[symbol], 0u);
+		}
+
+		return MakeEntry(0u, 0u, entryFlag::INVALID);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t GetPrecodeEntry(unsigned int symbol)
+	{
+		return MakeEntry(symbol, 0u, 0u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int ReverseBits(unsigned int code, unsigned int length)
+	{
+		unsigned int result = 0u;
+		for (unsigned int i=0; i < length; ++i)
+		{
+			result = (result << 1u) | (code & 1u);
+			code >>= 1u;
+		}
+
+		return result;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <uint32_t (*GetEntry)(unsigned int)>
+	static bool BuildTable(const uint8_t* lengths, unsigned int symbolCount, unsigned int tableBits, unsigned int tableSize, bool allowIncomplete, uint32_t* table)
+	{
+		unsigned int counts[MAX_CODEWORD_LENGTH + 1u] = {};
+		for (unsigned int i=0; i < symbolCount; ++i)
+		{
+			++counts[lengths[i]];
+		}
+		counts[0] = 0u;
+
+		// the code must not be over-subscribed. incomplete codes are only valid for a single codeword of length 1, like in zlib.
+		int left = 1;
+		unsigned int maxLength = 0u;
+		unsigned int codewordCount = 0u;
+		for (unsigned int length=1u; length <= MAX_CODEWORD_LENGTH; ++length)
+		{
+			left = (left << 1) - static_cast<int>(counts[length]);
+			if (left < 0)
+			{
+				return false;
+			}
+
+			if (counts[length] != 0u)
+			{
+				maxLength = length;
+			}
+			codewordCount += counts[length];
+		}
+
+		if ((left > 0) && (codewordCount > 0u) && (!allowIncomplete || (maxLength != 1u)))
+		{
+			return false;
+		}
+
+		const unsigned int mainSize = 1u << tableBits;
+		const uint32_t invalidEntry = MakeEntry(0u, 0u, entryFlag::INVALID);
+		for (unsigned int i=0; i < mainSize; ++i)
+		{
+			table[i] = invalidEntry;
+		}
+
+		// canonical codewords are assigned in order of increasing length, and increasing symbol value for equal lengths
+		unsigned int offsets[MAX_CODEWORD_LENGTH + 1u] = {};
+		for (unsigned int length=1u; length < MAX_CODEWORD_LENGTH; ++length)
+		{
+			offsets[length + 1u] = offsets[length] + counts[length];
+		}
+
+		uint16_t sortedSymbols[LITLEN_SYMBOL_COUNT];
+		for (unsigned int i=0; i < symbolCount; ++i)
+		{
+			if (lengths[i] != 0u)
+			{
+				sortedSymbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+			}
+		}
+
+		// the stream stores codewords starting with their most significant bit, so the codewords are bit-reversed in
+		// order to index the tables with the next bits of the stream.
+		unsigned int nextCode[MAX_CODEWORD_LENGTH + 1u] = {};
+		unsigned int code = 0u;
+		for (unsigned int length=1u; length <= MAX_CODEWORD_LENGTH; ++length)
+		{
+			code = (code + counts[length - 1u]) << 1u;
+			nextCode[length] = code;
+		}
+
+		uint16_t reversedCodes[LITLEN_SYMBOL_COUNT];
+		for (unsigned int i=0; i < codewordCount; ++i)
+		{
+			const unsigned int length = lengths[sortedSymbols[i]];
+			reversedCodes[i] = static_cast<uint16_t>(ReverseBits(nextCode[length]++, length));
+		}
+
+		unsigned int subtablePrefix = ~0u;
+		unsigned int subtableStart = 0u;
+		unsigned int subtableBits = 0u;
+		unsigned int nextSubtable = mainSize;
+		for (unsigned int i=0; i < codewordCount; ++i)
+		{
+			const unsigned int symbol = sortedSymbols[i];
+			const unsigned int length = lengths[symbol];
+			const unsigned int reversed = reversedCodes[i];
+			const uint32_t entry = GetEntry(symbol);
+
+			if (length <= tableBits)
+			{
+				// the entry is replicated for all combinations of the bits following the codeword
+				for (unsigned int j = reversed; j < mainSize; j += 1u << length)
+				{
+					table[j] = entry | length;
+				}
+
+				continue;
+			}
+
+			const unsigned int prefix = reversed & (mainSize - 1u);
+			if (prefix != subtablePrefix)
+			{
+				// codewords sharing a prefix are consecutive in canonical order, and the last of them is the longest
+				unsigned int last = i;
+				while ((last + 1u < codewordCount) && ((reversedCodes[last + 1u] & (mainSize - 1u)) == prefix))
+				{
+					++last;
+				}
+
+				subtablePrefix = prefix;
+				subtableStart = nextSubtable;
+				subtableBits = lengths[sortedSymbols[last]] - tableBits;
+				nextSubtable += 1u << subtableBits;
+				if (nextSubtable > tableSize)
+				{
+					return false;
+				}
+
+				for (unsigned int j = subtableStart; j < nextSubtable; ++j)
+				{
+					table[j] = invalidEntry;
+				}
+
+				table[prefix] = MakeEntry(subtableStart, subtableBits, entryFlag::SUBTABLE) | tableBits;
+			}
+
+			const unsigned int subtableLength = length - tableBits;
+			for (unsigned int j = reversed >> tableBits; j < (1u << subtableBits); j += 1u << subtableLength)
+			{
+				table[subtableStart + j] = entry | subtableLength;
+			}
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void PairLiterals(uint32_t* litlenTable)
+	{
+		// a literal that leaves enough bits in the main table for determining the codeword following it is paired with
+		// the next literal, so that both can be decoded with a single lookup.
+		// entries are paired in descending order, because the following codeword is looked up at a lower index.
+		const unsigned int mainSize = 1u << LITLEN_TABLE_BITS;
+		for (unsigned int i = mainSize; i-- > 0u; )
+		{
+			const uint32_t first = litlenTable[i];
+			if (!(first & entryFlag::LITERAL))
+			{
+				continue;
+			}
+
+			const unsigned int firstLength = GetBitCount(first);
+			const uint32_t second = litlenTable[i >> firstLength];
+			if ((second & entryFlag::LITERAL) && (firstLength + GetBitCount(second) <= LITLEN_TABLE_BITS))
+			{
+				litlenTable[i] = MakeEntry(GetValue(first) | (GetValue(second) << 8u), 2u, entryFlag::LITERAL) | (firstLength + GetBitCount(second));
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void Refill(BitStream& stream)
+	{
+		if (stream.end - stream.next >= 8)
+		{
+			// load a whole word, but only advance by the number of whole bytes that fit into the buffer.
+			// the bits above the buffered ones belong to the next byte, and are loaded again by the next refill.
+			uint64_t word;
+			memcpy(&word, stream.next, sizeof(uint64_t));
+
+			stream.buffer |= word << stream.bitCount;
+			stream.next += (63u - stream.bitCount) >> 3u;
+			stream.bitCount |= 56u;
+		}
+		else
+		{
+			// near the end of the stream, bytes are added one at a time. zero bytes are appended past the end, and it is
+			// checked at the end of the stream that none of them were consumed.
+			while (stream.bitCount < 56u)
+			{
+				if (stream.next < stream.end)
+				{
+					stream.buffer |= static_cast<uint64_t>(*stream.next++) << stream.bitCount;
+				}
+				else
+				{
+					++stream.overrunCount;
+				}
+
+				stream.bitCount += 8u;
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int PeekBits(const BitStream& stream, unsigned int count)
+	{
+		return static_cast<unsigned int>(stream.buffer & ((static_cast<uint64_t>(1u) << count) - 1u));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void ConsumeBits(BitStream& stream, unsigned int count)
+	{
+		stream.buffer >>= count;
+		stream.bitCount -= count;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int ReadBits(BitStream& stream, unsigned int count)
+	{
+		if (stream.bitCount < count)
+		{
+			Refill(stream);
+		}
+
+		const unsigned int value = PeekBits(stream, count);
+		ConsumeBits(stream, count);
+
+		return value;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool AlignToByte(BitStream& stream)
+	{
+		// drop the remaining bits of the current byte, and hand the whole bytes that are still buffered back to the stream
+		ConsumeBits(stream, stream.bitCount & 7u);
+
+		const unsigned int byteCount = stream.bitCount >> 3u;
+		if (stream.overrunCount > byteCount)
+		{
+			return false;
+		}
+
+		stream.next -= byteCount - stream.overrunCount;
+		stream.buffer = 0u;
+		stream.bitCount = 0u;
+		stream.overrunCount = 0u;
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool BuildFixedTables(HuffmanTables& tables)
+	{
+		uint8_t lengths[LITLEN_SYMBOL_COUNT];
+		memset(lengths, 8, 144u);
+		memset(lengths + 144u, 9, 112u);
+		memset(lengths + 256u, 7, 24u);
+		memset(lengths + 280u, 8, 8u);
+		if (!BuildTable<GetLitlenEntry>(lengths, LITLEN_SYMBOL_COUNT, LITLEN_TABLE_BITS, LITLEN_TABLE_SIZE, true, tables.litlen))
+		{
+			return false;
+		}
+		PairLiterals(tables.litlen);
+
+		memset(lengths, 5, DISTANCE_SYMBOL_COUNT);
+		return BuildTable<GetDistanceEntry>(lengths, DISTANCE_SYMBOL_COUNT, DISTANCE_TABLE_BITS, DISTANCE_TABLE_SIZE, true, tables.distance);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadDynamicTables(BitStream& stream, HuffmanTables& tables)
+	{
+		const unsigned int litlenCount = ReadBits(stream, 5u) + 257u;
+		const unsigned int distanceCount = ReadBits(stream, 5u) + 1u;
+		const unsigned int precodeCount = ReadBits(stream, 4u) + 4u;
+		if ((litlenCount > 286u) || (distanceCount > 30u))
+		{
+			return false;
+		}
+
+		// the codeword lengths of both codes are themselves Huffman-coded using the precode
+		uint8_t precodeLengths[PRECODE_SYMBOL_COUNT] = {};
+		for (unsigned int i=0; i < precodeCount; ++i)
+		{
+			precodeLengths[PRECODE_ORDER[i]] = static_cast<uint8_t>(ReadBits(stream, 3u));
+		}
+
+		uint32_t precodeTable[PRECODE_TABLE_SIZE];
+		if (!BuildTable<GetPrecodeEntry>(precodeLengths, PRECODE_SYMBOL_COUNT, PRECODE_TABLE_BITS, PRECODE_TABLE_SIZE, false, precodeTable))
+		{
+			return false;
+		}
+
+		uint8_t lengths[LITLEN_SYMBOL_COUNT + DISTANCE_SYMBOL_COUNT];
+		const unsigned int totalCount = litlenCount + distanceCount;
+		unsigned int count = 0u;
+		while (count < totalCount)
+		{
+			if (stream.bitCount < PRECODE_TABLE_BITS + 7u)
+			{
+				Refill(stream);
+			}
+
+			const uint32_t entry = precodeTable[PeekBits(stream, PRECODE_TABLE_BITS)];
+			if (entry & entryFlag::INVALID)
+			{
+				return false;
+			}
+			ConsumeBits(stream, GetBitCount(entry));
+
+			const unsigned int symbol = GetValue(entry);
+			if (symbol < 16u)
+			{
+				lengths[count++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			// symbols 16-18 repeat the previous length, or a length of zero
+			uint8_t value = 0u;
+			unsigned int repeatCount = 0u;
+			if (symbol == 16u)
+			{
+				if (count == 0u)
+				{
+					return false;
+				}
+
+				value = lengths[count - 1u];
+				repeatCount = 3u + ReadBits(stream, 2u);
+			}
+			else if (symbol == 17u)
+			{
+				repeatCount = 3u + ReadBits(stream, 3u);
+			}
+			else
+			{
+				repeatCount = 11u + ReadBits(stream, 7u);
+			}
+
+			if (repeatCount > totalCount - count)
+			{
+				return false;
+			}
+
+			memset(lengths + count, value, repeatCount);
+			count += repeatCount;
+		}
+
+		// a block without an end-of-block codeword cannot be decoded
+		if (lengths[256] == 0u)
+		{
+			return false;
+		}
+
+		if (!BuildTable<GetLitlenEntry>(lengths, litlenCount, LITLEN_TABLE_BITS, LITLEN_TABLE_SIZE, true, tables.litlen))
+		{
+			return false;
+		}
+		PairLiterals(tables.litlen);
+
+		return BuildTable<GetDistanceEntry>(lengths + litlenCount, distanceCount, DISTANCE_TABLE_BITS, DISTANCE_TABLE_SIZE, true, tables.distance);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadStoredBlockLength(BitStream& stream, unsigned int& length)
+	{
+		if (!AlignToByte(stream) || (stream.end - stream.next < 4))
+		{
+			return false;
+		}
+
+		length = stream.next[0] | (stream.next[1] << 8u);
+		const unsigned int lengthComplement = stream.next[2] | (stream.next[3] << 8u);
+		stream.next += 4;
+
+		return (length == (~lengthComplement & 0xFFFFu));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool InflateStoredBlock(BitStream& stream, uint8_t*& out, uint8_t* destEnd)
+	{
+		unsigned int length = 0u;
+		if (!ReadStoredBlockLength(stream, length) || (length > static_cast<size_t>(stream.end - stream.next)) || (length > static_cast<size_t>(destEnd - out)))
+		{
+			return false;
+		}
+
+		memcpy(out, stream.next, length);
+		stream.next += length;
+		out += length;
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE uint32_t DecodeEntry(BitStream& stream, const uint32_t* table, unsigned int tableBits)
+	{
+		uint32_t entry = table[PeekBits(stream, tableBits)];
+		if (entry & entryFlag::SUBTABLE)
+		{
+			ConsumeBits(stream, GetBitCount(entry));
+			entry = table[GetValue(entry) + PeekBits(stream, GetExtraBitCount(entry))];
+		}
+		ConsumeBits(stream, GetBitCount(entry));
+
+		return entry;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE unsigned int ReadExtraBits(BitStream& stream, uint32_t entry)
+	{
+		const unsigned int value = GetValue(entry) + PeekBits(stream, GetExtraBitCount(entry));
+		ConsumeBits(stream, GetExtraBitCount(entry));
+
+		return value;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void StoreLiterals(uint8_t*& out, uint32_t entry)
+	{
+		// stores both literals of an entry in little-endian order, even if it only holds one
+		const uint16_t literals = static_cast<uint16_t>(GetValue(entry));
+		memcpy(out, &literals, sizeof(uint16_t));
+		out += GetExtraBitCount(entry);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE void CopyMatch(uint8_t* out, size_t distance, size_t length)
+	{
+		// matches are copied in whole words whenever the source does not overlap a single word.
+		// this writes up to 7 bytes past the end of the match, which the caller must allow for.
+		const uint8_t* src = out - distance;
+		uint8_t* const matchEnd = out + length;
+		if (distance >= WORD_SIZE)
+		{
+			do
+			{
+				memcpy(out, src, WORD_SIZE);
+				out += WORD_SIZE;
+				src += WORD_SIZE;
+			}
+			while (out < matchEnd);
+		}
+		else if (distance == 1u)
+		{
+			memset(out, src[0], length);
+		}
+		else
+		{
+			while (out < matchEnd)
+			{
+				*out++ = *src++;
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static blockResult::Enum InflateHuffmanBlock(BitStream& streamRef, const HuffmanTables& tables, uint8_t* dest, uint8_t*& outRef, uint8_t* destEnd, uint8_t* suspendAt)
+	{
+		// decoding is suspended in between two symbols once the output reaches suspendAt, unless it is the end of the output.
+		// a refill leaves at least 56 bits in the buffer. this is enough for decoding a literal/length codeword with its
+		// extra bits (15 + 5), followed by a distance codeword with its extra bits (15 + 13), or for decoding three
+		// entries of literals that are stored in the main table (3 * 11).
+		// the stream is copied so that it can be kept in registers, because stores to the output could alias it otherwise.
+		BitStream stream = streamRef;
+		uint8_t* out = outRef;
+
+		while ((static_cast<size_t>(destEnd - out) >= FAST_OUTPUT_MARGIN) && (out < suspendAt))
+		{
+			Refill(stream);
+
+			// both literals of an entry are always stored, and the output only advances by the number of literals
+			uint32_t entry = tables.litlen[PeekBits(stream, LITLEN_TABLE_BITS)];
+			if (entry & entryFlag::LITERAL)
+			{
+				ConsumeBits(stream, GetBitCount(entry));
+				StoreLiterals(out, entry);
+
+				entry = tables.litlen[PeekBits(stream, LITLEN_TABLE_BITS)];
+				if (entry & entryFlag::LITERAL)
+				{
+					ConsumeBits(stream, GetBitCount(entry));
+					StoreLiterals(out, entry);
+
+					entry = tables.litlen[PeekBits(stream, LITLEN_TABLE_BITS)];
+					if (entry & entryFlag::LITERAL)
+					{
+						ConsumeBits(stream, GetBitCount(entry));
+						StoreLiterals(out, entry);
+						continue;
+					}
+				}
+
+				Refill(stream);
+			}
+
+			if (entry & entryFlag::SUBTABLE)
+			{
+				ConsumeBits(stream, GetBitCount(entry));
+				entry = tables.litlen[GetValue(entry) + PeekBits(stream, GetExtraBitCount(entry))];
+			}
+			ConsumeBits(stream, GetBitCount(entry));
+
+			if (entry & entryFlag::LITERAL)
+			{
+				StoreLiterals(out, entry);
+				continue;
+			}
+			else if (entry & entryFlag::END_OF_BLOCK)
+			{
+				streamRef = stream;
+				outRef = out;
+				return blockResult::END_OF_BLOCK;
+			}
+			else if (entry & entryFlag::INVALID)
+			{
+				return blockResult::INVALID;
+			}
+
+			const size_t length = ReadExtraBits(stream, entry);
+
+			entry = DecodeEntry(stream, tables.distance, DISTANCE_TABLE_BITS);
+			if (entry & entryFlag::INVALID)
+			{
+				return blockResult::INVALID;
+			}
+
+			const size_t distance = ReadExtraBits(stream, entry);
+			if (distance > static_cast<size_t>(out - dest))
+			{
+				return blockResult::INVALID;
+			}
+
+			CopyMatch(out, distance, length);
+			out += length;
+		}
+
+		// close to the end of the output, each symbol is checked against the remaining space
+		for (;;)
+		{
+			if ((out >= suspendAt) && (suspendAt != destEnd))
+			{
+				streamRef = stream;
+				outRef = out;
+				return blockResult::SUSPENDED;
+			}
+
+			Refill(stream);
+
+			uint32_t entry = DecodeEntry(stream, tables.litlen, LITLEN_TABLE_BITS);
+			if (entry & entryFlag::LITERAL)
+			{
+				const unsigned int literalCount = GetExtraBitCount(entry);
+				if (literalCount > static_cast<size_t>(destEnd - out))
+				{
+					return blockResult::INVALID;
+				}
+
+				out[0] = static_cast<uint8_t>(GetValue(entry));
+				if (literalCount == 2u)
+				{
+					out[1] = static_cast<uint8_t>(GetValue(entry) >> 8u);
+				}
+				out += literalCount;
+				continue;
+			}
+			else if (entry & entryFlag::END_OF_BLOCK)
+			{
+				streamRef = stream;
+				outRef = out;
+				return blockResult::END_OF_BLOCK;
+			}
+			else if (entry & entryFlag::INVALID)
+			{
+				return blockResult::INVALID;
+			}
+
+			const size_t length = ReadExtraBits(stream, entry);
+
+			entry = DecodeEntry(stream, tables.distance, DISTANCE_TABLE_BITS);
+			if (entry & entryFlag::INVALID)
+			{
+				return blockResult::INVALID;
+			}
+
+			const size_t distance = ReadExtraBits(stream, entry);
+			if ((distance > static_cast<size_t>(out - dest)) || (length > static_cast<size_t>(destEnd - out)))
+			{
+				return blockResult::INVALID;
+			}
+
+			for (size_t i=0; i < length; ++i)
+			{
+				out[i] = out[i - distance];
+			}
+			out += length;
+		}
+	}
+
+
+#if PSD_USE_SSE
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void AccumulateAdler32SSE(const uint8_t* data, size_t blockCount, uint32_t& a, uint32_t& b)
+	{
+		// for each block of 16 bytes, a grows by the sum of the bytes, and b grows by 16 times the previous a, plus the
+		// bytes weighted by 16 down to 1. the sums of all blocks are kept in vectors, and the previous values of a are
+		// accumulated separately and multiplied by 16 at the end.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weightsLo = _mm_set_epi16(9, 10, 11, 12, 13, 14, 15, 16);
+		const __m128i weightsHi = _mm_set_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+
+		__m128i sumA = zero;
+		__m128i sumPreviousA = zero;
+		__m128i sumB = zero;
+		for (size_t i=0; i < blockCount; ++i, data += 16u)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			sumPreviousA = _mm_add_epi32(sumPreviousA, sumA);
+			sumA = _mm_add_epi32(sumA, _mm_sad_epu8(bytes, zero));
+			sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLo));
+			sumB = _mm_add_epi32(sumB, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHi));
+		}
+
+		uint32_t lanesA[4];
+		uint32_t lanesPreviousA[4];
+		uint32_t lanesB[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanesA), sumA);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanesPreviousA), sumPreviousA);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanesB), sumB);
+
+		// the sums of absolute differences are stored in the lower half of each 64-bit lane
+		const uint32_t previousA = (lanesPreviousA[0] + lanesPreviousA[2]) % ADLER_MODULUS;
+		b += static_cast<uint32_t>(blockCount*16u)*a + 16u*previousA + lanesB[0] + lanesB[1] + lanesB[2] + lanesB[3];
+		a += lanesA[0] + lanesA[2];
+	}
+#endif
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t UpdateAdler32(uint32_t adler, const uint8_t* data, size_t size)
+	{
+		uint32_t a = adler & 0xFFFFu;
+		uint32_t b = adler >> 16u;
+		while (size > 0u)
+		{
+			size_t count = (size < ADLER_BLOCK_SIZE) ? size : ADLER_BLOCK_SIZE;
+			size -= count;
+
+#if PSD_USE_SSE
+			AccumulateAdler32SSE(data, count / 16u, a, b);
+			data += count & ~static_cast<size_t>(15u);
+			count &= 15u;
+#else
+			for (; count >= 8u; count -= 8u, data += 8u)
+			{
+				a += data[0]; b += a;
+				a += data[1]; b += a;
+				a += data[2]; b += a;
+				a += data[3]; b += a;
+				a += data[4]; b += a;
+				a += data[5]; b += a;
+				a += data[6]; b += a;
+				a += data[7]; b += a;
+			}
+#endif
+
+			for (; count > 0u; --count)
+			{
+				a += *data++;
+				b += a;
+			}
+
+			a %= ADLER_MODULUS;
+			b %= ADLER_MODULUS;
+		}
+
+		return (b << 16u) | a;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadZlibHeader(BitStream& stream)
+	{
+		// the zlib header stores the compression method and window size, and must not ask for a preset dictionary
+		if (stream.end - stream.next < 2)
+		{
+			return false;
+		}
+
+		const unsigned int cmf = stream.next[0];
+		const unsigned int flags = stream.next[1];
+		if (((cmf & 0x0Fu) != 8u) || ((cmf >> 4u) > 7u) || ((((cmf << 8u) | flags) % 31u) != 0u) || (flags & 0x20u))
+		{
+			return false;
+		}
+
+		stream.next += 2;
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadChecksum(BitStream& stream, uint32_t& checksum)
+	{
+		// the deflate stream is followed by the big-endian Adler-32 checksum of the inflated data
+		if (!AlignToByte(stream) || (stream.end - stream.next < 4))
+		{
+			return false;
+		}
+
+		checksum = (static_cast<uint32_t>(stream.next[0]) << 24u) | (static_cast<uint32_t>(stream.next[1]) << 16u) | (static_cast<uint32_t>(stream.next[2]) << 8u) | stream.next[3];
+		stream.next += 4;
+
+		return true;
+	}
+}
+#endif
+
+
+namespace imageUtil
+{
+	struct InflateState
+	{
+		size_t readOffset;						///< The offset of the next byte in the buffer that is handed out.
+		size_t writeOffset;						///< The offset behind the last byte in the buffer that was inflated.
+		size_t remainingSize;					///< The number of bytes that are still to be inflated.
+		bool isFinished;
+		bool isFailed;
+
+#if PSD_USE_MINIZ_INFLATE
+		const uint8_t* next;
+		const uint8_t* end;
+		tinfl_decompressor decompressor;
+		uint8_t buffer[TINFL_LZ_DICT_SIZE];		///< The wrapping buffer that miniz keeps its window in.
+#else
+		BitStream stream;
+		unsigned int blockState;
+		bool isFinalBlock;
+		unsigned int storedSize;				///< The number of bytes left in the current stored block.
+		uint32_t adler;
+		HuffmanTables tables;
+		uint8_t buffer[INFLATE_BUFFER_SIZE];
+#endif
+	};
+}
+
+
+namespace
+{
+#if PSD_USE_MINIZ_INFLATE
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool InflateIntoBuffer(imageUtil::InflateState& state)
+	{
+		// all inflated data has been handed out at this point, so miniz can wrap around to the start of the buffer
+		if (state.writeOffset == TINFL_LZ_DICT_SIZE)
+		{
+			state.readOffset = 0u;
+			state.writeOffset = 0u;
+		}
+
+		size_t inSize = static_cast<size_t>(state.end - state.next);
+		size_t outSize = TINFL_LZ_DICT_SIZE - state.writeOffset;
+		const tinfl_status status = tinfl_decompress(&state.decompressor, state.next, &inSize, state.buffer, state.buffer + state.writeOffset, &outSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
+		state.next += inSize;
+		state.writeOffset += outSize;
+		if ((outSize > state.remainingSize) || ((status != TINFL_STATUS_DONE) && (status != TINFL_STATUS_HAS_MORE_OUTPUT)))
+		{
+			return false;
+		}
+
+		state.remainingSize -= outSize;
+		state.isFinished = (status == TINFL_STATUS_DONE);
+
+		return true;
+	}
+#else
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool InflateIntoBuffer(imageUtil::InflateState& state)
+	{
+		// all inflated data has been handed out at this point. once the buffer is full, its last 32 KB are moved to the
+		// front, because matches can refer to them.
+		if (state.writeOffset >= 2u*WINDOW_SIZE)
+		{
+			memcpy(state.buffer, state.buffer + state.writeOffset - WINDOW_SIZE, WINDOW_SIZE);
+			state.readOffset = WINDOW_SIZE;
+			state.writeOffset = WINDOW_SIZE;
+		}
+
+		BitStream& stream = state.stream;
+		uint8_t* const start = state.buffer + state.writeOffset;
+		uint8_t* const suspendAt = state.buffer + 2u*WINDOW_SIZE;
+		uint8_t* out = start;
+		while ((out < suspendAt) && (state.blockState != blockState::CHECKSUM))
+		{
+			if (state.blockState == blockState::HEADER)
+			{
+				state.isFinalBlock = (ReadBits(stream, 1u) != 0u);
+				const unsigned int blockType = ReadBits(stream, 2u);
+
+				bool success = false;
+				if (blockType == 0u)
+				{
+					success = ReadStoredBlockLength(stream, state.storedSize);
+					state.blockState = blockState::STORED;
+				}
+				else if (blockType == 1u)
+				{
+					success = BuildFixedTables(state.tables);
+					state.blockState = blockState::HUFFMAN;
+				}
+				else if (blockType == 2u)
+				{
+					success = ReadDynamicTables(stream, state.tables);
+					state.blockState = blockState::HUFFMAN;
+				}
+
+				if (!success)
+				{
+					return false;
+				}
+			}
+			else if (state.blockState == blockState::STORED)
+			{
+				// stored blocks are copied in pieces, the stream stays aligned to a byte while doing so
+				const size_t remainingSize = static_cast<size_t>(suspendAt - out);
+				const size_t count = (state.storedSize < remainingSize) ? state.storedSize : remainingSize;
+				if (count > static_cast<size_t>(stream.end - stream.next))
+				{
+					return false;
+				}
+
+				memcpy(out, stream.next, count);
+				stream.next += count;
+				out += count;
+				state.storedSize -= static_cast<unsigned int>(count);
+				if (state.storedSize == 0u)
+				{
+					state.blockState = state.isFinalBlock ? blockState::CHECKSUM : blockState::HEADER;
+				}
+			}
+			else
+			{
+				// the buffer leaves room for a whole match behind suspendAt, so its end is never reached
+				const blockResult::Enum result = InflateHuffmanBlock(stream, state.tables, state.buffer, out, state.buffer + INFLATE_BUFFER_SIZE, suspendAt);
+				if (result == blockResult::INVALID)
+				{
+					return false;
+				}
+				else if (result == blockResult::END_OF_BLOCK)
+				{
+					state.blockState = state.isFinalBlock ? blockState::CHECKSUM : blockState::HEADER;
+				}
+			}
+		}
+
+		const size_t count = static_cast<size_t>(out - start);
+		if (count > state.remainingSize)
+		{
+			return false;
+		}
+
+		state.adler = UpdateAdler32(state.adler, start, count);
+		state.writeOffset += count;
+		state.remainingSize -= count;
+
+		if (state.blockState == blockState::CHECKSUM)
+		{
+			uint32_t checksum = 0u;
+			if (!ReadChecksum(stream, checksum) || (checksum != state.adler))
+			{
+				return false;
+			}
+
+			state.isFinished = true;
+		}
+
+		return true;
+	}
+#endif
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	bool Inflate(const uint8_t* PSD_RESTRICT src, size_t srcSize, uint8_t* PSD_RESTRICT dest, size_t size)
+	{
+		PSD_ASSERT_NOT_NULL(src);
+		PSD_ASSERT_NOT_NULL(dest);
+
+#if PSD_USE_MINIZ_INFLATE
+		return (tinfl_decompress_mem_to_mem(dest, size, src, srcSize, TINFL_FLAG_PARSE_ZLIB_HEADER) != TINFL_DECOMPRESS_MEM_TO_MEM_FAILED);
+#else
+		BitStream stream = { src, src + srcSize, 0u, 0u, 0u };
+		if (!ReadZlibHeader(stream))
+		{
+			return false;
+		}
+
+		HuffmanTables tables;
+
+		uint8_t* out = dest;
+		uint8_t* destEnd = dest + size;
+		bool isFinalBlock = false;
+		while (!isFinalBlock)
+		{
+			isFinalBlock = (ReadBits(stream, 1u) != 0u);
+			const unsigned int blockType = ReadBits(stream, 2u);
+
+			bool success = false;
+			if (blockType == 0u)
+			{
+				success = InflateStoredBlock(stream, out, destEnd);
+			}
+			else if (blockType == 1u)
+			{
+				success = BuildFixedTables(tables) && (InflateHuffmanBlock(stream, tables, dest, out, destEnd, destEnd) == blockResult::END_OF_BLOCK);
+			}
+			else if (blockType == 2u)
+			{
+				success = ReadDynamicTables(stream, tables) && (InflateHuffmanBlock(stream, tables, dest, out, destEnd, destEnd) == blockResult::END_OF_BLOCK);
+			}
+
+			if (!success)
+			{
+				return false;
+			}
+		}
+
+		uint32_t checksum = 0u;
+		return ReadChecksum(stream, checksum) && (checksum == UpdateAdler32(1u, dest, static_cast<size_t>(out - dest)));
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	InflateState* CreateInflateState(const uint8_t* src, size_t srcSize, size_t size, Allocator* allocator)
+	{
+		PSD_ASSERT_NOT_NULL(src);
+		PSD_ASSERT_NOT_NULL(allocator);
+
+		InflateState* state = static_cast<InflateState*>(allocator->Allocate(sizeof(InflateState), 16u, allocationTag::DECODE_SCRATCH));
+		state->readOffset = 0u;
+		state->writeOffset = 0u;
+		state->remainingSize = size;
+		state->isFinished = false;
+		state->isFailed = false;
+
+#if PSD_USE_MINIZ_INFLATE
+		state->next = src;
+		state->end = src + srcSize;
+		tinfl_init(&state->decompressor);
+#else
+		state->stream.next = src;
+		state->stream.end = src + srcSize;
+		state->stream.buffer = 0u;
+		state->stream.bitCount = 0u;
+		state->stream.overrunCount = 0u;
+		state->blockState = blockState::HEADER;
+		state->isFinalBlock = false;
+		state->storedSize = 0u;
+		state->adler = 1u;
+
+		// the header is checked right away, so that the stream only needs to be looked at again when inflating
+		state->isFailed = !ReadZlibHeader(state->stream);
+#endif
+
+		return state;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void DestroyInflateState(InflateState*& state, Allocator* allocator)
+	{
+		PSD_ASSERT_NOT_NULL(allocator);
+
+		allocator->Free(state);
+		state = nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	bool InflateContinue(InflateState* state, uint8_t* PSD_RESTRICT dest, size_t size)
+	{
+		PSD_ASSERT_NOT_NULL(state);
+
+		while (!state->isFailed)
+		{
+			const size_t availableSize = state->writeOffset - state->readOffset;
+			const size_t count = (size < availableSize) ? size : availableSize;
+			memcpy(dest, state->buffer + state->readOffset, count);
+			state->readOffset += count;
+			dest += count;
+			size -= count;
+
+			// once all data has been handed out, the end of the stream is inflated as well in order to verify the checksum
+			const bool isComplete = (state->remainingSize == 0u) && (state->readOffset == state->writeOffset);
+			if ((size == 0u) && (!isComplete || state->isFinished))
+			{
+				return true;
+			}
+			else if (state->isFinished || !InflateIntoBuffer(*state))
+			{
+				state->isFailed = true;
+			}
+		}
+
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	bool InflateRows(InflateState* state, uint8_t* PSD_RESTRICT dest, size_t rowSize, unsigned int rowCount)
+	{
+		return InflateContinue(state, dest, rowSize*rowCount);
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,52 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+/// \def PSD_USE_MINIZ_INFLATE
+/// \ingroup Platform
+/// \brief Selects the backend used by \ref imageUtil::Inflate. If defined to 1, ZIP-compressed data is inflated using the
+/// bundled miniz library instead of the built-in table-driven decoder.
+#if !defined(PSD_USE_MINIZ_INFLATE)
+	#define PSD_USE_MINIZ_INFLATE 0
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+class Allocator;
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Inflates a zlib stream (RFC 1950) holding DEFLATE data (RFC 1951), and verifies its Adler-32 checksum.
+	/// Never reads more than \a srcSize bytes from \a src and never writes more than \a size bytes to \a dest.
+	/// Returns false if the stream is malformed or inflates to more than \a size bytes.
+	bool Inflate(const uint8_t* PSD_RESTRICT src, size_t srcSize, uint8_t* PSD_RESTRICT dest, size_t size);
+
+	/// \ingroup ImageUtil
+	/// Holds the state of a zlib stream that is inflated incrementally, including the window of the last 32 KB of inflated data.
+	struct InflateState;
+
+	/// \ingroup ImageUtil
+	/// Creates a state for inflating the zlib stream in \a src incrementally, which must inflate to exactly \a size bytes.
+	/// The stream is not copied, so \a src must stay valid until the state is destroyed using \ref DestroyInflateState.
+	InflateState* CreateInflateState(const uint8_t* src, size_t srcSize, size_t size, Allocator* allocator);
+
+	/// \ingroup ImageUtil
+	/// Destroys a state created by \ref CreateInflateState, and nullifies \a state.
+	void DestroyInflateState(InflateState*& state, Allocator* allocator);
+
+	/// \ingroup ImageUtil
+	/// Inflates the next \a size bytes of the stream into \a dest, resuming where the previous call stopped.
+	/// The checksum is verified once all bytes have been handed out. Returns false if the stream is malformed, or does not
+	/// inflate to exactly the size given to \ref CreateInflateState. After an error, all further calls return false.
+	bool InflateContinue(InflateState* state, uint8_t* PSD_RESTRICT dest, size_t size);
+
+	/// \ingroup ImageUtil
+	/// Inflates the next \a rowCount rows of \a rowSize bytes each into \a dest, see \ref InflateContinue.
+	bool InflateRows(InflateState* state, uint8_t* PSD_RESTRICT dest, size_t rowSize, unsigned int rowCount);
+}
+
+PSD_NAMESPACE_END
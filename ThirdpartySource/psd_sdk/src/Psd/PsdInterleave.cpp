@@ -5,18 +5,7 @@
 #include "PsdInterleave.h"
 
 #include "PsdUnionCast.h"
-
-#if !defined(PSD_USE_SSE)
-	#if defined(_M_IX86) || defined(_M_X64)
-		#define PSD_USE_SSE 1
-	#else
-		#define PSD_USE_SSE 0
-	#endif
-#endif
-
-#if PSD_USE_SSE
-	#include <emmintrin.h>
-#endif
+#include "PsdSimd.h"
 
 
 PSD_NAMESPACE_BEGIN
@@ -86,88 +75,268 @@ namespace
 #endif
 
 
+#if PSD_USE_AVX2
+// interleaves either 8-bit, 16-bit, 32-bit or 64-bit values from two AVX2 registers.
+// note that AVX2 unpack instructions operate on each 128-bit lane individually.
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <unsigned int N>
+	__m256i InterleaveLo256(__m256i a, __m256i b);
+
+	template <> PSD_TARGET_AVX2 __m256i InterleaveLo256<1>(__m256i a, __m256i b) { return _mm256_unpacklo_epi8(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveLo256<2>(__m256i a, __m256i b) { return _mm256_unpacklo_epi16(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveLo256<4>(__m256i a, __m256i b) { return _mm256_unpacklo_epi32(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveLo256<8>(__m256i a, __m256i b) { return _mm256_unpacklo_epi64(a, b); }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <unsigned int N>
+	__m256i InterleaveHi256(__m256i a, __m256i b);
+
+	template <> PSD_TARGET_AVX2 __m256i InterleaveHi256<1>(__m256i a, __m256i b) { return _mm256_unpackhi_epi8(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveHi256<2>(__m256i a, __m256i b) { return _mm256_unpackhi_epi16(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveHi256<4>(__m256i a, __m256i b) { return _mm256_unpackhi_epi32(a, b); }
+	template <> PSD_TARGET_AVX2 __m256i InterleaveHi256<8>(__m256i a, __m256i b) { return _mm256_unpackhi_epi64(a, b); }
+}
+#endif
+
+
 namespace imageUtil
 {
 #if PSD_USE_SSE
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
+	PSD_INLINE void InterleaveBlock(__m128i vr, __m128i vg, __m128i vb, __m128i va, T* PSD_RESTRICT dest)
 	{
-		const unsigned int pixelCount = width*height;
-		const unsigned int blockCount = pixelCount / blockSize;
+		const unsigned int blockSize = sizeof(__m128i) / sizeof(T);
+
+		// interleave R and G
+		const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
+		const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
+
+		// interleave B and A
+		const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
+		const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
+
+		// interleave RG and BA
+		const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+		const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+		// store to memory non-temporal, bypassing cache
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	unsigned int InterleaveBlocksSSE(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = sizeof(__m128i) / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
 		const __m128i va = SplatValue(alpha);
 
 		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
 		{
 			// load pixels from R, G, B
-			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
-			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
-			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
-
-			// interleave R and G
-			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
-			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
-
-			// interleave B and A
-			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
-			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
-
-			// interleave RG and BA
-			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-
-			// store to memory non-temporal, bypassing cache
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+			const __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcR));
+			const __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcG));
+			const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcB));
+
+			InterleaveBlock(vr, vg, vb, va, dest);
 		}
 
-		return blockCount;
+		// make the non-temporal stores visible before returning
+		_mm_sfence();
+
+		return blockCount*blockSize;
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
+	unsigned int InterleaveBlocksSSE(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
 	{
-		const unsigned int pixelCount = width*height;
-		const unsigned int blockCount = pixelCount / blockSize;
+		const unsigned int blockSize = sizeof(__m128i) / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
 
 		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
 		{
 			// load pixels from R, G, B, and A
-			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
-			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
-			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
-			const __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(srcA));
-
-			// interleave R and G
-			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
-			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
-
-			// interleave B and A
-			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
-			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
-
-			// interleave RG and BA
-			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-
-			// store to memory non-temporal, bypassing cache
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+			const __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcR));
+			const __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcG));
+			const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcB));
+			const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcA));
+
+			InterleaveBlock(vr, vg, vb, va, dest);
 		}
 
-		return blockCount;
+		// make the non-temporal stores visible before returning
+		_mm_sfence();
+
+		return blockCount*blockSize;
+	}
+#endif
+
+
+#if PSD_USE_AVX2
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	PSD_TARGET_AVX2 PSD_INLINE void InterleaveBlockAVX2(__m256i vr, __m256i vg, __m256i vb, __m256i va, T* PSD_RESTRICT dest)
+	{
+		const unsigned int blockSize = sizeof(__m128i) / sizeof(T);
+
+		// interleave R and G, and B and A. each 128-bit lane holds the lower or upper half of the 32 bytes, respectively.
+		const __m256i rg_interleaved_lo = InterleaveLo256<sizeof(T)>(vr, vg);
+		const __m256i rg_interleaved_hi = InterleaveHi256<sizeof(T)>(vr, vg);
+		const __m256i ba_interleaved_lo = InterleaveLo256<sizeof(T)>(vb, va);
+		const __m256i ba_interleaved_hi = InterleaveHi256<sizeof(T)>(vb, va);
+
+		// interleave RG and BA. the lower lanes hold the first 4 blocks of pixels, the upper lanes hold the last 4 blocks.
+		const __m256i rgba_1 = InterleaveLo256<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m256i rgba_2 = InterleaveHi256<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m256i rgba_3 = InterleaveLo256<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+		const __m256i rgba_4 = InterleaveHi256<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+		// bring the lanes back into pixel order, and store to memory non-temporal, bypassing cache
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dest), _mm256_permute2x128_si256(rgba_1, rgba_2, 0x20));
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dest + blockSize*2u), _mm256_permute2x128_si256(rgba_3, rgba_4, 0x20));
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dest + blockSize*4u), _mm256_permute2x128_si256(rgba_1, rgba_2, 0x31));
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dest + blockSize*6u), _mm256_permute2x128_si256(rgba_3, rgba_4, 0x31));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	PSD_TARGET_AVX2 unsigned int InterleaveBlocksAVX2(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = sizeof(__m256i) / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+		const __m256i va = _mm256_broadcastsi128_si256(SplatValue(alpha));
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
+		{
+			// load pixels from R, G, B. source buffers are not necessarily aligned.
+			const __m256i vr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcR));
+			const __m256i vg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcG));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcB));
+
+			InterleaveBlockAVX2(vr, vg, vb, va, dest);
+		}
+
+		// make the non-temporal stores visible before returning
+		_mm_sfence();
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	PSD_TARGET_AVX2 unsigned int InterleaveBlocksAVX2(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = sizeof(__m256i) / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		{
+			// load pixels from R, G, B, and A. source buffers are not necessarily aligned.
+			const __m256i vr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcR));
+			const __m256i vg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcG));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcB));
+			const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcA));
+
+			InterleaveBlockAVX2(vr, vg, vb, va, dest);
+		}
+
+		// make the non-temporal stores visible before returning
+		_mm_sfence();
+
+		return blockCount*blockSize;
+	}
+#endif
+
+
+#if PSD_USE_NEON
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE uint8x16x4_t LoadBlockNEON(const uint8_t* srcR, const uint8_t* srcG, const uint8_t* srcB, uint8x16_t va)
+	{
+		const uint8x16x4_t block = { { vld1q_u8(srcR), vld1q_u8(srcG), vld1q_u8(srcB), va } };
+		return block;
+	}
+
+	PSD_INLINE uint16x8x4_t LoadBlockNEON(const uint16_t* srcR, const uint16_t* srcG, const uint16_t* srcB, uint16x8_t va)
+	{
+		const uint16x8x4_t block = { { vld1q_u16(srcR), vld1q_u16(srcG), vld1q_u16(srcB), va } };
+		return block;
+	}
+
+	PSD_INLINE float32x4x4_t LoadBlockNEON(const float32_t* srcR, const float32_t* srcG, const float32_t* srcB, float32x4_t va)
+	{
+		const float32x4x4_t block = { { vld1q_f32(srcR), vld1q_f32(srcG), vld1q_f32(srcB), va } };
+		return block;
+	}
+
+	PSD_INLINE uint8x16_t SplatValueNEON(uint8_t value) { return vdupq_n_u8(value); }
+	PSD_INLINE uint16x8_t SplatValueNEON(uint16_t value) { return vdupq_n_u16(value); }
+	PSD_INLINE float32x4_t SplatValueNEON(float32_t value) { return vdupq_n_f32(value); }
+
+	PSD_INLINE uint8x16_t LoadNEON(const uint8_t* src) { return vld1q_u8(src); }
+	PSD_INLINE uint16x8_t LoadNEON(const uint16_t* src) { return vld1q_u16(src); }
+	PSD_INLINE float32x4_t LoadNEON(const float32_t* src) { return vld1q_f32(src); }
+
+	// the structured store interleaves four registers element by element
+	PSD_INLINE void StoreBlockNEON(uint8_t* dest, const uint8x16x4_t& block) { vst4q_u8(dest, block); }
+	PSD_INLINE void StoreBlockNEON(uint16_t* dest, const uint16x8x4_t& block) { vst4q_u16(dest, block); }
+	PSD_INLINE void StoreBlockNEON(float32_t* dest, const float32x4x4_t& block) { vst4q_f32(dest, block); }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	unsigned int InterleaveBlocksNEON(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 16u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+		const auto va = SplatValueNEON(alpha);
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
+		{
+			StoreBlockNEON(dest, LoadBlockNEON(srcR, srcG, srcB, va));
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	unsigned int InterleaveBlocksNEON(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 16u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		{
+			StoreBlockNEON(dest, LoadBlockNEON(srcR, srcG, srcB, LoadNEON(srcA)));
+		}
+
+		return blockCount*blockSize;
 	}
 #endif
 
@@ -213,58 +382,95 @@ namespace imageUtil
 	}
 
 
-#if PSD_USE_SSE
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	void InterleaveRGB(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
 	{
-		// do blocks first, and then copy remaining pixels
-		const unsigned int blockCount = InterleaveBlocks(srcR, srcG, srcB, alpha, dest, width, height, blockSize);
-		const unsigned int remaining = width*height - blockCount*blockSize;
-		CopyRemainingPixels(srcR + blockCount*blockSize, srcG + blockCount*blockSize, srcB + blockCount*blockSize, alpha, dest + blockCount*blockSize*4u, remaining);
+		// use the widest instruction set available, and return the number of pixels that have been interleaved
+#if PSD_USE_AVX2
+		// the AVX2 path needs a destination aligned to 32 bytes for its non-temporal stores
+		if (simdUtil::HasAvx2() && ((reinterpret_cast<uintptr_t>(dest) & 31u) == 0u))
+		{
+			return InterleaveBlocksAVX2(srcR, srcG, srcB, alpha, dest, count);
+		}
+#endif
+
+#if PSD_USE_SSE
+		return InterleaveBlocksSSE(srcR, srcG, srcB, alpha, dest, count);
+#elif PSD_USE_NEON
+		return InterleaveBlocksNEON(srcR, srcG, srcB, alpha, dest, count);
+#else
+		PSD_UNUSED(srcR);
+		PSD_UNUSED(srcG);
+		PSD_UNUSED(srcB);
+		PSD_UNUSED(alpha);
+		PSD_UNUSED(dest);
+		PSD_UNUSED(count);
+		return 0u;
+#endif
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	void InterleaveRGBA(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
 	{
-		// do blocks first, and then copy remaining pixels
-		const unsigned int blockCount = InterleaveBlocks(srcR, srcG, srcB, srcA, dest, width, height, blockSize);
-		const unsigned int remaining = width*height - blockCount*blockSize;
-		CopyRemainingPixels(srcR + blockCount*blockSize, srcG + blockCount*blockSize, srcB + blockCount*blockSize, srcA + blockCount*blockSize, dest + blockCount*blockSize*4u, remaining);
-	}
+		// use the widest instruction set available, and return the number of pixels that have been interleaved
+#if PSD_USE_AVX2
+		// the AVX2 path needs a destination aligned to 32 bytes for its non-temporal stores
+		if (simdUtil::HasAvx2() && ((reinterpret_cast<uintptr_t>(dest) & 31u) == 0u))
+		{
+			return InterleaveBlocksAVX2(srcR, srcG, srcB, srcA, dest, count);
+		}
+#endif
+
+#if PSD_USE_SSE
+		return InterleaveBlocksSSE(srcR, srcG, srcB, srcA, dest, count);
+#elif PSD_USE_NEON
+		return InterleaveBlocksNEON(srcR, srcG, srcB, srcA, dest, count);
 #else
+		PSD_UNUSED(srcR);
+		PSD_UNUSED(srcG);
+		PSD_UNUSED(srcB);
+		PSD_UNUSED(srcA);
+		PSD_UNUSED(dest);
+		PSD_UNUSED(count);
+		return 0u;
+#endif
+	}
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	void InterleaveRGB(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int /* blockSize */)
+	void InterleaveRGB(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		// copy pixels
-		const unsigned int count = width * height;
-		CopyRemainingPixels(srcR, srcG, srcB, alpha, dest, count);
+		// do blocks first, and then copy remaining pixels
+		const unsigned int count = width*height;
+		const unsigned int done = InterleaveBlocks(srcR, srcG, srcB, alpha, dest, count);
+		CopyRemainingPixels(srcR + done, srcG + done, srcB + done, alpha, dest + done*4u, count - done);
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	void InterleaveRGBA(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int /* blockSize */)
+	void InterleaveRGBA(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		// copy pixels
-		const unsigned int count = width * height;
-		CopyRemainingPixels(srcR, srcG, srcB, srcA, dest, count);
+		// do blocks first, and then copy remaining pixels
+		const unsigned int count = width*height;
+		const unsigned int done = InterleaveBlocks(srcR, srcG, srcB, srcA, dest, count);
+		CopyRemainingPixels(srcR + done, srcG + done, srcB + done, srcA + done, dest + done*4u, count - done);
 	}
-#endif
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, uint8_t alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 16u);
+		InterleaveRGB<uint8_t>(srcR, srcG, srcB, alpha, dest, width, height);
 	}
 
 
@@ -272,7 +478,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 16u);
+		InterleaveRGBA<uint8_t>(srcR, srcG, srcB, srcA, dest, width, height);
 	}
 
 
@@ -280,7 +486,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, uint16_t alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 8u);
+		InterleaveRGB<uint16_t>(srcR, srcG, srcB, alpha, dest, width, height);
 	}
 
 
@@ -288,7 +494,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 8u);
+		InterleaveRGBA<uint16_t>(srcR, srcG, srcB, srcA, dest, width, height);
 	}
 
 
@@ -296,7 +502,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, float32_t alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 4u);
+		InterleaveRGB<float32_t>(srcR, srcG, srcB, alpha, dest, width, height);
 	}
 
 
@@ -304,7 +510,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 4u);
+		InterleaveRGBA<float32_t>(srcR, srcG, srcB, srcA, dest, width, height);
 	}
 
 
@@ -11,39 +11,39 @@ namespace imageUtil
 	/// \ingroup ImageUtil
 	/// Turns planar 8-bit RGB data into interleaved RGBA data with a constant, predefined alpha.
 	/// The destination buffer \a dest must hold "width*height*4" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGB(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, uint8_t alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 	/// \ingroup ImageUtil
 	/// Turns planar 8-bit RGBA data into interleaved RGBA data.
 	/// The destination buffer \a dest must hold "width*height*4" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGBA(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 
 	/// \ingroup ImageUtil
 	/// Turns planar 16-bit RGB data into interleaved RGBA data with a constant, predefined alpha.
 	/// The destination buffer \a dest must hold "width*height*8" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGB(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, uint16_t alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 	/// \ingroup ImageUtil
 	/// Turns planar 16-bit RGBA data into interleaved RGBA data.
 	/// The destination buffer \a dest must hold "width*height*8" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGBA(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 
 	/// \ingroup ImageUtil
 	/// Turns planar 32-bit RGB data into interleaved RGBA data with a constant, predefined alpha.
 	/// The destination buffer \a dest must hold "width*height*16" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGB(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, float32_t alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 	/// \ingroup ImageUtil
 	/// Turns planar 32-bit RGBA data into interleaved RGBA data.
 	/// The destination buffer \a dest must hold "width*height*16" bytes.
-	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \remark The destination buffer must be aligned to 16 bytes, the source buffers only need the alignment of their data type.
 	void InterleaveRGBA(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 
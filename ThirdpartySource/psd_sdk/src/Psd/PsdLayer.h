@@ -43,6 +43,10 @@ struct Layer
 	bool isVisible;						///< The layer's visibility.
 	bool isPassThrough;					///< If the layer is a pass-through group.
 
+	uint64_t recordOffset;				///< The file offset of the layer's mask data, blending ranges, name and additional layer information.
+	uint32_t recordLength;				///< The length of the layer's mask data, blending ranges, name and additional layer information.
+	bool isRecordParsed;				///< Whether the layer's name, masks and additional layer information have been parsed, see \ref ParseLayerRecord.
+
    
 };
 
@@ -0,0 +1,194 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdLinearArenaAllocator.h"
+
+#include "PsdAssert.h"
+#include "PsdBitUtil.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// The header of each chunk, which is immediately followed by the chunk's memory.
+struct LinearArenaAllocator::Chunk
+{
+	Chunk* next;
+	size_t size;						///< The number of bytes following the header.
+	size_t offset;						///< The offset of the first free byte following the header.
+};
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename Chunk>
+	static uint8_t* GetChunkData(Chunk* chunk)
+	{
+		return reinterpret_cast<uint8_t*>(chunk) + sizeof(Chunk);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename Chunk>
+	static void* BumpAllocate(Chunk* chunk, size_t size, size_t alignment)
+	{
+		// alignment is applied to the address rather than the offset, because chunks are only aligned to 16 bytes
+		const uintptr_t data = reinterpret_cast<uintptr_t>(GetChunkData(chunk));
+		const uintptr_t address = bitUtil::RoundUpToMultiple<uintptr_t>(data + chunk->offset, alignment);
+		if (address + size > data + chunk->size)
+		{
+			return nullptr;
+		}
+
+		chunk->offset = static_cast<size_t>(address + size - data);
+		return reinterpret_cast<void*>(address);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LinearArenaAllocator::LinearArenaAllocator(Allocator* backingAllocator, size_t chunkSize)
+	: m_backingAllocator(backingAllocator)
+	, m_chunkSize(chunkSize)
+	, m_firstChunk(nullptr)
+	, m_currentChunk(nullptr)
+	, m_allocatedSize(0u)
+	, m_lastAllocation(nullptr)
+	, m_lastOffset(0u)
+{
+	PSD_ASSERT_NOT_NULL(backingAllocator);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LinearArenaAllocator::~LinearArenaAllocator(void)
+{
+	Chunk* chunk = m_firstChunk;
+	while (chunk)
+	{
+		Chunk* next = chunk->next;
+		m_backingAllocator->Free(chunk);
+		chunk = next;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void LinearArenaAllocator::Reset(void)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// all other chunks are reset lazily once allocations reach them again
+	m_currentChunk = m_firstChunk;
+	if (m_currentChunk)
+	{
+		m_currentChunk->offset = 0u;
+	}
+
+	m_allocatedSize = 0u;
+	m_lastAllocation = nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+size_t LinearArenaAllocator::GetAllocatedSize(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_allocatedSize;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* LinearArenaAllocator::DoAllocate(size_t size, size_t alignment)
+{
+	PSD_ASSERT(bitUtil::IsPowerOfTwo(alignment), "Alignment must be a power-of-two.");
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Chunk* chunk = m_currentChunk;
+	size_t offset = chunk ? chunk->offset : 0u;
+	void* ptr = chunk ? BumpAllocate(chunk, size, alignment) : nullptr;
+	while (!ptr)
+	{
+		// reuse the chunks kept by a previous Reset, and add a new chunk in front of any chunk that is too small
+		Chunk* next = chunk ? chunk->next : m_firstChunk;
+		if (next)
+		{
+			next->offset = 0u;
+			ptr = BumpAllocate(next, size, alignment);
+		}
+
+		if (!ptr)
+		{
+			Chunk* newChunk = AllocateChunk(size, alignment);
+			newChunk->next = next;
+			if (chunk)
+			{
+				chunk->next = newChunk;
+			}
+			else
+			{
+				m_firstChunk = newChunk;
+			}
+
+			next = newChunk;
+			ptr = BumpAllocate(next, size, alignment);
+			PSD_ASSERT_NOT_NULL(ptr);
+		}
+
+		chunk = next;
+		offset = 0u;
+	}
+
+	m_currentChunk = chunk;
+	m_allocatedSize += chunk->offset - offset;
+	m_lastAllocation = ptr;
+	m_lastOffset = offset;
+
+	return ptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void LinearArenaAllocator::DoFree(void* ptr)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// only the most recent allocation can be given back, which makes short-lived scratch buffers free to reuse.
+	// all other memory is released by Reset.
+	if (ptr && (ptr == m_lastAllocation))
+	{
+		m_allocatedSize -= m_currentChunk->offset - m_lastOffset;
+		m_currentChunk->offset = m_lastOffset;
+		m_lastAllocation = nullptr;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LinearArenaAllocator::Chunk* LinearArenaAllocator::AllocateChunk(size_t size, size_t alignment)
+{
+	// large allocations get a chunk of their own, with enough room for aligning them
+	const size_t requiredSize = size + alignment - 1u;
+	const size_t chunkSize = (requiredSize > m_chunkSize) ? requiredSize : m_chunkSize;
+
+	Chunk* chunk = static_cast<Chunk*>(m_backingAllocator->Allocate(sizeof(Chunk) + chunkSize, 16u));
+	PSD_ASSERT_NOT_NULL(chunk);
+	chunk->next = nullptr;
+	chunk->size = chunkSize;
+	chunk->offset = 0u;
+
+	return chunk;
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,57 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdAllocator.h"
+#include <mutex>
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Allocators
+/// \brief Linear allocator that hands out memory from large chunks, and frees all of it at once.
+/// \details Allocations are carved out of chunks obtained from a backing allocator by simply bumping an offset, honoring
+/// the requested alignment. Freeing individual allocations does not return memory, except for the most recent allocation.
+/// Instead, all allocations are released at once by calling \ref Reset, which keeps the chunks around for the next parse
+/// session, or by destroying the allocator, which returns the chunks to the backing allocator.
+/// This makes the allocator well suited for backing all allocations made while parsing a document: data structures
+/// allocated from it do not need to be destroyed individually, e.g. a call to \ref DestroyLayerMaskSection can be skipped
+/// in favor of a call to \ref Reset.
+/// The allocator is thread-safe, so it can also be used with the multi-threaded extraction functions.
+/// \sa Allocator
+class LinearArenaAllocator : public Allocator
+{
+public:
+	/// Constructor initializing the allocator with a \a backingAllocator that chunks of at least \a chunkSize bytes are
+	/// allocated from. Allocations larger than a chunk get a chunk of their own.
+	LinearArenaAllocator(Allocator* backingAllocator, size_t chunkSize);
+
+	/// Returns all chunks to the backing allocator.
+	virtual ~LinearArenaAllocator(void);
+
+	/// Releases all allocations at once. The chunks are kept, and reused by subsequent allocations.
+	void Reset(void);
+
+	/// Returns the number of bytes currently allocated from the arena, including alignment padding.
+	size_t GetAllocatedSize(void) const;
+
+private:
+	struct Chunk;
+
+	virtual void* DoAllocate(size_t size, size_t alignment) PSD_OVERRIDE;
+	virtual void DoFree(void* ptr) PSD_OVERRIDE;
+
+	Chunk* AllocateChunk(size_t size, size_t alignment);
+
+	Allocator* m_backingAllocator;
+	size_t m_chunkSize;
+	Chunk* m_firstChunk;
+	Chunk* m_currentChunk;
+	size_t m_allocatedSize;
+	void* m_lastAllocation;
+	size_t m_lastOffset;
+	mutable std::mutex m_mutex;
+};
+
+PSD_NAMESPACE_END
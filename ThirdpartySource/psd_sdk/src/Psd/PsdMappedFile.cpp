@@ -0,0 +1,178 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdMappedFile.h"
+
+#include "PsdAllocator.h"
+#include "PsdStringUtil.h"
+#include "PsdLog.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(Allocator* allocator)
+	: File(allocator)
+	, m_data(nullptr)
+	, m_size(0ull)
+{
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoOpenRead(const wchar_t* filename)
+{
+	char* name = stringUtil::ConvertWString(filename, m_allocator);
+	if (!name)
+	{
+		PSD_ERROR("MappedFile", "Cannot convert filename \"%ls\".", filename);
+		return false;
+	}
+
+	const int fd = open(name, O_RDONLY);
+	if (fd == -1)
+	{
+		PSD_ERROR("MappedFile", "open(%s) => %s", name, strerror(errno));
+		m_allocator->Free(name);
+		return false;
+	}
+
+	struct stat s;
+	if ((fstat(fd, &s) == -1) || (s.st_size <= 0))
+	{
+		PSD_ERROR("MappedFile", "Cannot determine size of file \"%s\" or file is empty.", name);
+		close(fd);
+		m_allocator->Free(name);
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(s.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		PSD_ERROR("MappedFile", "mmap(%s) => %s", name, strerror(errno));
+		close(fd);
+		m_allocator->Free(name);
+		return false;
+	}
+
+	// the mapping stays valid after closing the descriptor
+	close(fd);
+	m_allocator->Free(name);
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<uint64_t>(s.st_size);
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoOpenWrite(const wchar_t* filename)
+{
+	PSD_ERROR("MappedFile", "Cannot open file \"%ls\" for writing, mapped files are read-only.", filename);
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoClose(void)
+{
+	if (!m_data)
+	{
+		return true;
+	}
+
+	const int result = munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+	m_data = nullptr;
+	m_size = 0ull;
+
+	if (result == -1)
+	{
+		PSD_ERROR("MappedFile", "munmap() => %s", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::ReadOperation MappedFile::DoRead(void* buffer, uint32_t count, uint64_t position)
+{
+	const void* data = DoGetData(position, count);
+	if (!data)
+	{
+		PSD_ERROR("MappedFile", "Cannot read %u bytes at position %llu, file is only %llu bytes large.", count, static_cast<unsigned long long>(position), static_cast<unsigned long long>(m_size));
+		return nullptr;
+	}
+
+	memcpy(buffer, data, count);
+
+	// the read has already finished at this point, we only need a non-null operation to signal success
+	return this;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoWaitForRead(File::ReadOperation& operation)
+{
+	const bool success = (operation != nullptr);
+	operation = nullptr;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::WriteOperation MappedFile::DoWrite(const void*, uint32_t, uint64_t)
+{
+	PSD_ERROR("MappedFile", "Cannot write to a mapped file.");
+	return nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoWaitForWrite(File::WriteOperation&)
+{
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t MappedFile::DoGetSize(void) const
+{
+	return m_size;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* MappedFile::DoGetData(uint64_t position, uint64_t count) const
+{
+	if ((position > m_size) || (count > m_size - position))
+	{
+		return nullptr;
+	}
+
+	return m_data + position;
+}
+
+PSD_NAMESPACE_END
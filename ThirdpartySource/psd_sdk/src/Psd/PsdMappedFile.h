@@ -0,0 +1,42 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdFile.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Files
+/// \brief Read-only file implementation that maps the whole file into memory using POSIX mmap().
+/// \details Reads are served by copying from the mapping, leaving all buffering to the OS page cache. Because the contents are
+/// directly accessible in memory, GetData() returns pointers into the mapping, which allows parsing data in place.
+/// Opening a mapped file for writing is not supported.
+/// \sa File NativeFile
+class MappedFile : public File
+{
+public:
+	/// Constructor.
+	explicit MappedFile(Allocator* allocator);
+
+private:
+	virtual bool DoOpenRead(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoOpenWrite(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoClose(void) PSD_OVERRIDE;
+
+	virtual File::ReadOperation DoRead(void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForRead(File::ReadOperation& operation) PSD_OVERRIDE;
+
+	virtual File::WriteOperation DoWrite(const void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForWrite(File::WriteOperation& operation) PSD_OVERRIDE;
+
+	virtual uint64_t DoGetSize(void) const PSD_OVERRIDE;
+
+	virtual const void* DoGetData(uint64_t position, uint64_t count) const PSD_OVERRIDE;
+
+	const uint8_t* m_data;
+	uint64_t m_size;
+};
+
+PSD_NAMESPACE_END
@@ -0,0 +1,153 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdMemoryFile.h"
+
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include "PsdLog.h"
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+MemoryFile::MemoryFile(Allocator* allocator)
+	: File(allocator)
+	, m_data(nullptr)
+	, m_size(0ull)
+	, m_isOwned(false)
+{
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::OpenMemory(const void* data, uint64_t size)
+{
+	PSD_ASSERT_NOT_NULL(data);
+	PSD_ASSERT(m_data == nullptr, "Memory file is already open.");
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = size;
+	m_isOwned = false;
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::OpenMemoryOwned(void* data, uint64_t size)
+{
+	const bool success = OpenMemory(data, size);
+	m_isOwned = true;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::DoOpenRead(const wchar_t* filename)
+{
+	PSD_ERROR("MemoryFile", "Cannot open file \"%ls\", memory files must be opened using OpenMemory().", filename);
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::DoOpenWrite(const wchar_t* filename)
+{
+	PSD_ERROR("MemoryFile", "Cannot open file \"%ls\" for writing, memory files are read-only.", filename);
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::DoClose(void)
+{
+	if (m_isOwned)
+	{
+		m_allocator->Free(const_cast<uint8_t*>(m_data));
+	}
+
+	m_data = nullptr;
+	m_size = 0ull;
+	m_isOwned = false;
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::ReadOperation MemoryFile::DoRead(void* buffer, uint32_t count, uint64_t position)
+{
+	const void* data = DoGetData(position, count);
+	if (!data)
+	{
+		PSD_ERROR("MemoryFile", "Cannot read %u bytes at position %llu, file is only %llu bytes large.", count, static_cast<unsigned long long>(position), static_cast<unsigned long long>(m_size));
+		return nullptr;
+	}
+
+	memcpy(buffer, data, count);
+
+	// the read has already finished at this point, we only need a non-null operation to signal success
+	return this;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::DoWaitForRead(File::ReadOperation& operation)
+{
+	const bool success = (operation != nullptr);
+	operation = nullptr;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::WriteOperation MemoryFile::DoWrite(const void*, uint32_t, uint64_t)
+{
+	PSD_ERROR("MemoryFile", "Cannot write to a memory file.");
+	return nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MemoryFile::DoWaitForWrite(File::WriteOperation&)
+{
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t MemoryFile::DoGetSize(void) const
+{
+	return m_size;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* MemoryFile::DoGetData(uint64_t position, uint64_t count) const
+{
+	if (!m_data || (position > m_size) || (count > m_size - position))
+	{
+		return nullptr;
+	}
+
+	return m_data + position;
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,50 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdFile.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Files
+/// \brief Read-only file implementation that works on a block of memory holding the contents of a PSD file.
+/// \details This allows parsing PSD files that already are in memory without going through the file system. All reads are
+/// served by copying from memory, and GetData() returns pointers into the memory block.
+/// Opening a memory file by name or for writing is not supported, use OpenMemory() or OpenMemoryOwned() instead.
+/// \sa File MappedFile
+class MemoryFile : public File
+{
+public:
+	/// Constructor.
+	explicit MemoryFile(Allocator* allocator);
+
+	/// Opens the file on \a size bytes of memory owned by the caller. The memory must stay valid until the file is closed.
+	bool OpenMemory(const void* data, uint64_t size);
+
+	/// Opens the file on \a size bytes of memory that was allocated using the allocator given to the constructor. The file
+	/// takes ownership of the memory, and frees it when the file is closed.
+	bool OpenMemoryOwned(void* data, uint64_t size);
+
+private:
+	virtual bool DoOpenRead(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoOpenWrite(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoClose(void) PSD_OVERRIDE;
+
+	virtual File::ReadOperation DoRead(void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForRead(File::ReadOperation& operation) PSD_OVERRIDE;
+
+	virtual File::WriteOperation DoWrite(const void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForWrite(File::WriteOperation& operation) PSD_OVERRIDE;
+
+	virtual uint64_t DoGetSize(void) const PSD_OVERRIDE;
+
+	virtual const void* DoGetData(uint64_t position, uint64_t count) const PSD_OVERRIDE;
+
+	const uint8_t* m_data;
+	uint64_t m_size;
+	bool m_isOwned;
+};
+
+PSD_NAMESPACE_END
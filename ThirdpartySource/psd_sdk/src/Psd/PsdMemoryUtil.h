@@ -24,6 +24,10 @@ namespace memoryUtil
 	template <typename T>
 	inline T* AllocateArray(Allocator* allocator, size_t count);
 
+	/// Allocates memory for \a count instances of type T like \ref AllocateArray, and attributes the allocation to a \a tag.
+	template <typename T>
+	inline T* AllocateArray(Allocator* allocator, size_t count, const char* tag);
+
 	/// Frees memory previously allocated with \a allocator, and nullifies \a ptr.
 	template <typename T>
 	inline void Free(Allocator* allocator, T*& ptr);
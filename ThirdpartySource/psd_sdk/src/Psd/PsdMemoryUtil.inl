@@ -84,6 +84,18 @@ namespace memoryUtil
 	}
 
 
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	inline T* AllocateArray(Allocator* allocator, size_t count, const char* tag)
+	{
+		PSD_ASSERT_NOT_NULL(allocator);
+		static_assert(util::IsPod<T>::value == true, "Type T must be a POD.");
+
+		return static_cast<T*>(allocator->Allocate(sizeof(T)*count, PSD_ALIGN_OF(T), tag));
+	}
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
@@ -3,6 +3,13 @@
 
 #pragma once
 
+// on Linux, NativeFile is implemented in PsdNativeFile_Linux.cpp and has a different layout
+#if defined(__linux__)
+
+#include "PsdNativeFile_Linux.h"
+
+#else
+
 #include "PsdFile.h"
 
 
@@ -35,3 +42,5 @@ private:
 };
 
 PSD_NAMESPACE_END
+
+#endif
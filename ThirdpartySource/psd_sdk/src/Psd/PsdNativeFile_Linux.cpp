@@ -20,6 +20,26 @@
 #include <cwchar>
 #include <string>
 
+// io_uring is used through raw system calls, so we only need the kernel headers and not liburing
+#if !defined(PSD_DISABLE_IO_URING) && defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		define PSD_USE_IO_URING 1
+#	endif
+#endif
+
+#ifndef PSD_USE_IO_URING
+#	define PSD_USE_IO_URING 0
+#endif
+
+#if PSD_USE_IO_URING
+#	include <linux/io_uring.h>
+#	include <sys/syscall.h>
+#	include <sys/mman.h>
+#	include <sys/uio.h>
+#	include <mutex>
+#	include <condition_variable>
+#endif
+
 
 namespace
 {
@@ -44,6 +64,465 @@ namespace
 		_Psd::memoryUtil::Free(alloc,operation);
 		return ret != -1;
 	}
+
+
+#if PSD_USE_IO_URING
+	// the completion queue is twice as large as the submission queue
+	static const unsigned int RING_SIZE = 128u;
+
+	// UIO_MAXIOV, the maximum number of buffers of a vectored read
+	static const unsigned int MAX_VECTOR_COUNT = 1024u;
+
+
+	struct Ring
+	{
+		int fd;
+
+		unsigned int* sqHead;
+		unsigned int* sqTail;
+		unsigned int* sqMask;
+		unsigned int* sqArray;
+		unsigned int sqEntries;
+		io_uring_sqe* sqes;
+
+		unsigned int* cqHead;
+		unsigned int* cqTail;
+		unsigned int* cqMask;
+		unsigned int cqEntries;
+		io_uring_cqe* cqes;
+
+		void* sqRing;
+		size_t sqRingSize;
+		void* cqRing;
+		size_t cqRingSize;
+		size_t sqesSize;
+
+		// all members below are protected by the mutex
+		std::mutex mutex;
+		std::condition_variable condition;
+		unsigned int inFlight;
+		bool isWaiting;
+		bool hasFailed;
+	};
+
+
+	struct RingOperation
+	{
+		iovec* vectors;
+		unsigned int vectorCount;
+		iovec vector;
+		uint64_t position;
+		int result;
+		uint8_t opcode;
+		bool isDone;
+	};
+
+
+	struct RingBatch
+	{
+		RingOperation* operations;
+		unsigned int operationCount;
+		iovec* vectors;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int RingSetup(unsigned int entries, io_uring_params* params)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int RingEnter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyRing(Ring*& ring, _Psd::Allocator* allocator)
+	{
+		if (ring->sqes)
+		{
+			munmap(ring->sqes, ring->sqesSize);
+		}
+		if (ring->cqRing && (ring->cqRing != ring->sqRing))
+		{
+			munmap(ring->cqRing, ring->cqRingSize);
+		}
+		if (ring->sqRing)
+		{
+			munmap(ring->sqRing, ring->sqRingSize);
+		}
+
+		close(ring->fd);
+		_Psd::memoryUtil::Free(allocator, ring);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static Ring* CreateRing(_Psd::Allocator* allocator)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(io_uring_params));
+
+		// io_uring might not be available, e.g. on older kernels or when it is disabled by a seccomp policy
+		const int fd = RingSetup(RING_SIZE, &params);
+		if (fd < 0)
+		{
+			return nullptr;
+		}
+
+		Ring* ring = _Psd::memoryUtil::Allocate<Ring>(allocator);
+		ring->fd = fd;
+		ring->sqRing = nullptr;
+		ring->cqRing = nullptr;
+		ring->sqes = nullptr;
+		ring->inFlight = 0u;
+		ring->isWaiting = false;
+		ring->hasFailed = false;
+
+		ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+		bool isSingleMapping = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+		isSingleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0u;
+		if (isSingleMapping)
+		{
+			const size_t size = (ring->sqRingSize > ring->cqRingSize) ? ring->sqRingSize : ring->cqRingSize;
+			ring->sqRingSize = size;
+			ring->cqRingSize = size;
+		}
+#endif
+
+		void* sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sqRing == MAP_FAILED)
+		{
+			PSD_ERROR("NativeFile", "mmap(IORING_OFF_SQ_RING) => %s", strerror(errno));
+			DestroyRing(ring, allocator);
+			return nullptr;
+		}
+		ring->sqRing = sqRing;
+
+		void* cqRing = sqRing;
+		if (!isSingleMapping)
+		{
+			cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED)
+			{
+				PSD_ERROR("NativeFile", "mmap(IORING_OFF_CQ_RING) => %s", strerror(errno));
+				DestroyRing(ring, allocator);
+				return nullptr;
+			}
+		}
+		ring->cqRing = cqRing;
+
+		void* sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED)
+		{
+			PSD_ERROR("NativeFile", "mmap(IORING_OFF_SQES) => %s", strerror(errno));
+			DestroyRing(ring, allocator);
+			return nullptr;
+		}
+		ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+		uint8_t* sq = static_cast<uint8_t*>(sqRing);
+		ring->sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+		ring->sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+		ring->sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+		ring->sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+		ring->sqEntries = params.sq_entries;
+
+		uint8_t* cq = static_cast<uint8_t*>(cqRing);
+		ring->cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+		ring->cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+		ring->cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+		ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		ring->cqEntries = params.cq_entries;
+
+		return ring;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ReapCompletions(Ring* ring)
+	{
+		// we are the only consumer of the completion queue, the kernel is the only producer
+		unsigned int head = *ring->cqHead;
+		const unsigned int tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			const io_uring_cqe& cqe = ring->cqes[head & *ring->cqMask];
+			RingOperation* operation = reinterpret_cast<RingOperation*>(static_cast<uintptr_t>(cqe.user_data));
+			operation->result = cqe.res;
+			operation->isDone = true;
+
+			++head;
+			--ring->inFlight;
+		}
+
+		__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void WaitForCompletions(Ring* ring, std::unique_lock<std::mutex>& lock)
+	{
+		// only one thread at a time waits inside the kernel. all other threads wait until it has consumed the completions,
+		// otherwise a thread could keep waiting for a completion that has already been consumed by another thread.
+		if (ring->isWaiting)
+		{
+			ring->condition.wait(lock);
+			return;
+		}
+
+		ring->isWaiting = true;
+		lock.unlock();
+
+		// the kernel never submits more entries than are in the submission queue, so this also submits everything that is
+		// queued, including operations that other threads queue while we are waiting.
+		int result = 0;
+		do
+		{
+			result = RingEnter(ring->fd, ring->sqEntries, 1u, IORING_ENTER_GETEVENTS);
+		}
+		while ((result < 0) && (errno == EINTR));
+		const int error = errno;
+
+		lock.lock();
+		ring->isWaiting = false;
+		if ((result < 0) && (error != EAGAIN) && (error != EBUSY))
+		{
+			PSD_ERROR("NativeFile", "io_uring_enter() => %s", strerror(error));
+			ring->hasFailed = true;
+		}
+
+		ReapCompletions(ring);
+		ring->condition.notify_all();
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void CompleteOperationSynchronously(int fd, RingOperation* operation)
+	{
+		// once the ring has failed, operations are carried out right away instead. completions are never reaped from a failed
+		// ring, so the operation is not referenced by the ring anymore, and can be freed like any other finished operation.
+		const ssize_t result = (operation->opcode == IORING_OP_READV)
+			? preadv(fd, operation->vectors, static_cast<int>(operation->vectorCount), static_cast<off_t>(operation->position))
+			: pwritev(fd, operation->vectors, static_cast<int>(operation->vectorCount), static_cast<off_t>(operation->position));
+
+		operation->result = (result < 0) ? -errno : static_cast<int>(result);
+		operation->isDone = true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void QueueOperation(Ring* ring, std::unique_lock<std::mutex>& lock, int fd, RingOperation* operation)
+	{
+		// never have more operations in flight than the completion queue can hold
+		while ((ring->inFlight >= ring->cqEntries) && !ring->hasFailed)
+		{
+			WaitForCompletions(ring, lock);
+		}
+
+		if (ring->hasFailed)
+		{
+			CompleteOperationSynchronously(fd, operation);
+			return;
+		}
+
+		// if the submission queue is full, hand the queued operations to the kernel without waiting for any of them
+		const unsigned int tail = *ring->sqTail;
+		while (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries)
+		{
+			if ((RingEnter(ring->fd, ring->sqEntries, 0u, 0u) < 0) && (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+			{
+				PSD_ERROR("NativeFile", "io_uring_enter() => %s", strerror(errno));
+				ring->hasFailed = true;
+				CompleteOperationSynchronously(fd, operation);
+				return;
+			}
+		}
+
+		const unsigned int index = tail & *ring->sqMask;
+		io_uring_sqe* sqe = &ring->sqes[index];
+		std::memset(sqe, 0, sizeof(io_uring_sqe));
+		sqe->opcode = operation->opcode;
+		sqe->fd = fd;
+		sqe->off = operation->position;
+		sqe->addr = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(operation->vectors));
+		sqe->len = operation->vectorCount;
+		sqe->user_data = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(operation));
+
+		ring->sqArray[index] = index;
+		__atomic_store_n(ring->sqTail, tail + 1u, __ATOMIC_RELEASE);
+		++ring->inFlight;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static RingOperation* CreateOperation(Ring* ring, int fd, uint8_t opcode, void* buffer, uint32_t count, uint64_t position, _Psd::Allocator* allocator)
+	{
+		RingOperation* operation = _Psd::memoryUtil::Allocate<RingOperation>(allocator);
+		operation->vector.iov_base = buffer;
+		operation->vector.iov_len = count;
+		operation->vectors = &operation->vector;
+		operation->vectorCount = 1u;
+		operation->position = position;
+		operation->result = 0;
+		operation->opcode = opcode;
+		operation->isDone = false;
+
+		std::unique_lock<std::mutex> lock(ring->mutex);
+		QueueOperation(ring, lock, fd, operation);
+
+		return operation;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static RingBatch* CreateBatch(Ring* ring, int fd, const _Psd::File::ReadRequest* requests, unsigned int count, _Psd::Allocator* allocator)
+	{
+		RingBatch* batch = _Psd::memoryUtil::Allocate<RingBatch>(allocator);
+		batch->vectors = _Psd::memoryUtil::AllocateArray<iovec>(allocator, count);
+		batch->operations = _Psd::memoryUtil::AllocateArray<RingOperation>(allocator, count);
+		batch->operationCount = 0u;
+
+		// requests for adjacent ranges are coalesced into a single vectored read
+		uint64_t end = 0ull;
+		for (unsigned int i=0; i < count; ++i)
+		{
+			iovec* vector = &batch->vectors[i];
+			vector->iov_base = requests[i].buffer;
+			vector->iov_len = requests[i].count;
+
+			RingOperation* previous = (batch->operationCount > 0u) ? &batch->operations[batch->operationCount - 1u] : nullptr;
+			if (previous && (end == requests[i].position) && (previous->vectorCount < MAX_VECTOR_COUNT))
+			{
+				++previous->vectorCount;
+			}
+			else
+			{
+				RingOperation* operation = &batch->operations[batch->operationCount++];
+				operation->vectors = vector;
+				operation->vectorCount = 1u;
+				operation->position = requests[i].position;
+				operation->result = 0;
+				operation->opcode = IORING_OP_READV;
+				operation->isDone = false;
+			}
+
+			end = requests[i].position + requests[i].count;
+		}
+
+		std::unique_lock<std::mutex> lock(ring->mutex);
+		for (unsigned int i=0; i < batch->operationCount; ++i)
+		{
+			QueueOperation(ring, lock, fd, &batch->operations[i]);
+		}
+
+		return batch;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool WaitForOperation(Ring* ring, int fd, RingOperation* operation)
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(ring->mutex);
+				while (!operation->isDone && !ring->hasFailed)
+				{
+					WaitForCompletions(ring, lock);
+				}
+			}
+
+			// operations that were still queued when the ring failed are not owned by the kernel anymore
+			if (!operation->isDone)
+			{
+				CompleteOperationSynchronously(fd, operation);
+			}
+
+			const int result = operation->result;
+			if (result < 0)
+			{
+				PSD_ERROR("NativeFile", "io_uring operation => %s", strerror(-result));
+				return false;
+			}
+			else if (result == 0)
+			{
+				// end of file
+				return true;
+			}
+
+			// a short transfer needs to be continued where it stopped
+			size_t transferred = static_cast<size_t>(result);
+			operation->position += transferred;
+			while ((operation->vectorCount > 0u) && (transferred >= operation->vectors->iov_len))
+			{
+				transferred -= operation->vectors->iov_len;
+				++operation->vectors;
+				--operation->vectorCount;
+			}
+
+			if (operation->vectorCount == 0u)
+			{
+				return true;
+			}
+
+			operation->vectors->iov_base = static_cast<uint8_t*>(operation->vectors->iov_base) + transferred;
+			operation->vectors->iov_len -= transferred;
+			operation->isDone = false;
+
+			std::unique_lock<std::mutex> lock(ring->mutex);
+			QueueOperation(ring, lock, fd, operation);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool WaitForSingleOperation(Ring* ring, int fd, RingOperation* operation, _Psd::Allocator* allocator)
+	{
+		const bool success = WaitForOperation(ring, fd, operation);
+		_Psd::memoryUtil::Free(allocator, operation);
+
+		return success;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool WaitForRingBatch(Ring* ring, int fd, RingBatch* batch, _Psd::Allocator* allocator)
+	{
+		bool success = true;
+		for (unsigned int i=0; i < batch->operationCount; ++i)
+		{
+			success &= WaitForOperation(ring, fd, &batch->operations[i]);
+		}
+
+		_Psd::memoryUtil::FreeArray(allocator, batch->operations);
+		_Psd::memoryUtil::FreeArray(allocator, batch->vectors);
+		_Psd::memoryUtil::Free(allocator, batch);
+
+		return success;
+	}
+#endif
 }
 
 
@@ -51,7 +530,8 @@ PSD_NAMESPACE_BEGIN
 
 NativeFile::NativeFile(Allocator *alloc):
 	File(alloc),
-	m_fd(-1)
+	m_fd(-1),
+	m_ring(nullptr)
 {
 
 }
@@ -68,6 +548,9 @@ bool NativeFile::DoOpenRead(const wchar_t* filename)
 		return false;
 	}
 	m_allocator->Free(name);
+#if PSD_USE_IO_URING
+	m_ring = CreateRing(m_allocator);
+#endif
 	return true;
 }
 bool NativeFile::DoOpenWrite(const wchar_t* filename){
@@ -81,10 +564,21 @@ bool NativeFile::DoOpenWrite(const wchar_t* filename){
 		return false;
 	}
 	m_allocator->Free(name);
+#if PSD_USE_IO_URING
+	m_ring = CreateRing(m_allocator);
+#endif
 	return true;
 }
 bool NativeFile::DoClose()
 {
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		Ring *ring = static_cast<Ring*>(m_ring);
+		DestroyRing(ring,m_allocator);
+		m_ring = nullptr;
+	}
+#endif
 	int ret = close(m_fd);
 	m_fd = -1;
 	return ret == 0;
@@ -94,6 +588,13 @@ bool NativeFile::DoClose()
 
 File::ReadOperation NativeFile::DoRead(void* buffer, uint32_t count, uint64_t position)
 {
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		//Only queued here, submitted when waiting
+		return CreateOperation(static_cast<Ring*>(m_ring),m_fd,IORING_OP_READV,buffer,count,position,m_allocator);
+	}
+#endif
 	aiocb *operation = memoryUtil::Allocate<aiocb>(m_allocator);
 	std::memset(operation,0,sizeof(aiocb));
 
@@ -117,6 +618,12 @@ File::ReadOperation NativeFile::DoRead(void* buffer, uint32_t count, uint64_t po
 }
 File::ReadOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uint64_t position)
 {
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		return CreateOperation(static_cast<Ring*>(m_ring),m_fd,IORING_OP_WRITEV,const_cast<void*>(buffer),count,position,m_allocator);
+	}
+#endif
 	aiocb *operation = memoryUtil::Allocate<aiocb>(m_allocator);
 	std::memset(operation,0,sizeof(aiocb));
 	
@@ -142,16 +649,51 @@ File::ReadOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uint
 
 bool NativeFile::DoWaitForRead(ReadOperation &_operation)
 {
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		return WaitForSingleOperation(static_cast<Ring*>(m_ring),m_fd,static_cast<RingOperation*>(_operation),m_allocator);
+	}
+#endif
 	aiocb *operation = static_cast<aiocb*>(_operation);
 	return generic_wait(operation,m_allocator);
 }
 bool NativeFile::DoWaitForWrite(ReadOperation &_operation)
 {
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		return WaitForSingleOperation(static_cast<Ring*>(m_ring),m_fd,static_cast<RingOperation*>(_operation),m_allocator);
+	}
+#endif
 	aiocb *operation = static_cast<aiocb*>(_operation);
 	return generic_wait(operation,m_allocator);
 }
 
 
+File::BatchOperation NativeFile::DoReadBatch(const ReadRequest* requests, unsigned int count)
+{
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		//Adjacent ranges become one vectored read, all of them submitted together
+		return CreateBatch(static_cast<Ring*>(m_ring),m_fd,requests,count,m_allocator);
+	}
+#endif
+	return File::DoReadBatch(requests,count);
+}
+bool NativeFile::DoWaitForBatch(BatchOperation &_operation)
+{
+#if PSD_USE_IO_URING
+	if(m_ring)
+	{
+		return WaitForRingBatch(static_cast<Ring*>(m_ring),m_fd,static_cast<RingBatch*>(_operation),m_allocator);
+	}
+#endif
+	return File::DoWaitForBatch(_operation);
+}
+
+
 uint64_t NativeFile::DoGetSize() const
 {
 	struct stat s;
@@ -9,7 +9,12 @@
 PSD_NAMESPACE_BEGIN
 
 /// \ingroup Files
-/// \brief Simple file implementation that uses Posix asio internally.
+/// \brief Simple file implementation that uses io_uring internally, falling back to Posix asio if io_uring is not available.
+/// \details With io_uring, read and write operations are only queued by Read() and Write(). All queued operations are
+/// submitted to the kernel in one batch as soon as any of them is waited upon, so issuing several reads before waiting
+/// for the first one lets the device work on all of them at once. Completions are consumed as they arrive, and it is
+/// valid to read from multiple threads in parallel.
+/// \remark Define PSD_DISABLE_IO_URING to always use Posix asio.
 /// \sa File
 class NativeFile : public File
 {
@@ -28,11 +33,16 @@ private:
 	virtual File::WriteOperation DoWrite(const void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
 	virtual bool DoWaitForWrite(File::WriteOperation& operation) PSD_OVERRIDE;
 
+	virtual File::BatchOperation DoReadBatch(const ReadRequest* requests, unsigned int count) PSD_OVERRIDE;
+	virtual bool DoWaitForBatch(File::BatchOperation& operation) PSD_OVERRIDE;
+
 	virtual uint64_t DoGetSize(void) const PSD_OVERRIDE;
 	
 	int m_fd;
+
+	// internally, this is an io_uring instance, or a nullptr if we fell back to Posix asio
+	void* m_ring;
 };
 
 
 PSD_NAMESPACE_END
-
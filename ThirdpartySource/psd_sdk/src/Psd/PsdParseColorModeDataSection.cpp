@@ -32,11 +32,11 @@ ColorModeDataSection* ParseColorModeDataSection(const Document* document, File*
 	ColorModeDataSection* colorModeData = memoryUtil::Allocate<ColorModeDataSection>(allocator);
 	*colorModeData = ColorModeDataSection();
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator);
 	reader.SetPosition(document->colorModeDataSection.offset);
 
 	colorModeData->colorData = memoryUtil::AllocateArray<uint8_t>(allocator, section.length);
-	colorModeData->sizeOfColorData = section.length;
+	colorModeData->sizeOfColorData = static_cast<uint32_t>(section.length);
 	reader.Read(colorModeData->colorData, section.length);
 
 	return colorModeData;
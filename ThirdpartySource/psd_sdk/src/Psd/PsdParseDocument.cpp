@@ -21,7 +21,7 @@ PSD_NAMESPACE_BEGIN
 // ---------------------------------------------------------------------------------------------------------------------
 Document* CreateDocument(File* file, Allocator* allocator)
 {
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator);
 	reader.SetPosition(0u);
 
 	// check signature, must be "8BPS"
@@ -34,14 +34,12 @@ Document* CreateDocument(File* file, Allocator* allocator)
 		}
 	}
 
-	// check version, must be 1
+	// check version, must be 1 for .PSD files or 2 for .PSB files
+	const uint16_t version = fileUtil::ReadFromFileBE<uint16_t>(reader);
+	if ((version != 1) && (version != 2))
 	{
-		const uint16_t version = fileUtil::ReadFromFileBE<uint16_t>(reader);
-		if (version != 1)
-		{
-			PSD_ERROR("PsdExtract", "File seems to be corrupt, version does not match 1.");
-			return nullptr;
-		}
+		PSD_ERROR("PsdExtract", "File seems to be corrupt, version does not match 1 or 2.");
+		return nullptr;
 	}
 
 	// check reserved bytes, must be zero
@@ -58,6 +56,7 @@ Document* CreateDocument(File* file, Allocator* allocator)
 	}
 
 	Document* document = memoryUtil::Allocate<Document>(allocator);
+	document->version = version;
 
 	// read in the number of channels.
 	// this is the number of channels contained in the document for all layers, including any alpha channels.
@@ -90,7 +89,10 @@ Document* CreateDocument(File* file, Allocator* allocator)
 		reader.Skip(length);
 	}
 	{
-		const uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		// .PSB files store the length of the layer and mask information section in 8 bytes
+		const uint64_t length = (version == 2)
+			? fileUtil::ReadFromFileBE<uint64_t>(reader)
+			: fileUtil::ReadFromFileBE<uint32_t>(reader);
 
 		document->layerMaskInfoSection.offset = reader.GetPosition();
 		document->layerMaskInfoSection.length = length;
@@ -100,7 +102,7 @@ Document* CreateDocument(File* file, Allocator* allocator)
 	{
 		// note that the image data section does NOT store its length in the first 4 bytes
 		document->imageDataSection.offset = reader.GetPosition();
-		document->imageDataSection.length = static_cast<uint32_t>(file->GetSize() - reader.GetPosition());
+		document->imageDataSection.length = file->GetSize() - reader.GetPosition();
 	}
 
 	return document;
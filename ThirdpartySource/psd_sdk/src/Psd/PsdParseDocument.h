@@ -13,7 +13,7 @@ class Allocator;
 
 /// \ingroup Parser
 /// Parses only the header and section offsets, and returns a newly created document that needs to be freed
-/// by a call to \ref DestroyDocument.
+/// by a call to \ref DestroyDocument. Both .PSD and .PSB (Large Document Format) files are supported.
 Document* CreateDocument(File* file, Allocator* allocator);
 
 /// \ingroup Parser
@@ -10,19 +10,38 @@
 #include "PsdPlanarImage.h"
 #include "PsdFile.h"
 #include "PsdAllocator.h"
+#include "PsdAllocationTag.h"
 #include "PsdEndianConversion.h"
 #include "PsdSyncFileReader.h"
 #include "PsdSyncFileUtil.h"
 #include "PsdMemoryUtil.h"
 #include "PsdDecompressRle.h"
+#include "PsdThreadUtil.h"
 #include "PsdAssert.h"
 #include "PsdLog.h"
+#include <cstring>
 
 
 PSD_NAMESPACE_BEGIN
 
 namespace
 {
+	// bands of RLE rows should be large enough to amortize the scheduling overhead
+	static const unsigned int MIN_BAND_HEIGHT = 64u;
+
+	// the size of a single read request is 32-bit, so larger ranges are read using several requests
+	static const uint64_t MAX_REQUEST_SIZE = 1ull << 30u;
+
+
+	/// The RLE-compressed data of all channels, and the location of each individual row.
+	struct RleImageData
+	{
+		const uint8_t* data;				///< The RLE data of all channels, following the scan line tables.
+		uint8_t* buffer;					///< Holds the data if it cannot be accessed in memory, or nullptr.
+		uint64_t* rowOffsets;				///< The offset of each row of each channel into the data, followed by the total size.
+	};
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
@@ -30,96 +49,307 @@ namespace
 	{
 		PSD_ASSERT_NOT_NULL(images);
 
-		const unsigned int size = width*height;
+		const size_t size = static_cast<size_t>(width)*height;
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
 			T* planarData = static_cast<T*>(images[i].data);
-			for (unsigned int j=0; j < size; ++j)
-			{
-				planarData[j] = endianUtil::BigEndianToNative(planarData[j]);
-			}
+			endianUtil::BigEndianToNativeArray(planarData, planarData, size);
 		}
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	static ImageDataSection* ReadImageDataSectionRaw(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel)
+	static bool ReadBatch(File* file, const File::ReadRequest* requests, unsigned int count)
 	{
-		const unsigned int size = width*height;
+		File::BatchOperation batch = file->ReadBatch(requests, count);
+		return file->WaitForBatch(batch);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetReadRequestCount(uint64_t size)
+	{
+		return static_cast<unsigned int>((size + MAX_REQUEST_SIZE - 1u) / MAX_REQUEST_SIZE);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static File::ReadRequest* AddReadRequests(File::ReadRequest* requests, uint8_t* buffer, uint64_t size, uint64_t position)
+	{
+		// fills in GetReadRequestCount(size) requests, and returns the first request following them
+		while (size != 0u)
+		{
+			const uint64_t count = (size < MAX_REQUEST_SIZE) ? size : MAX_REQUEST_SIZE;
+			requests->buffer = buffer;
+			requests->count = static_cast<uint32_t>(count);
+			requests->position = position;
+			++requests;
+
+			buffer += count;
+			position += count;
+			size -= count;
+		}
+
+		return requests;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static ImageDataSection* ReadImageDataSectionRaw(SyncFileReader& reader, File* file, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel)
+	{
+		const size_t size = static_cast<size_t>(width)*height*bytesPerPixel;
 		if (size == 0)
 			return nullptr;
 
 		ImageDataSection* imageData = memoryUtil::Allocate<ImageDataSection>(allocator);
 		imageData->imageCount = channelCount;
-		imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount);
+		imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount, allocationTag::LAYER_RECORDS);
 
 		// read data for all channels at once
+		const unsigned int requestCount = channelCount*GetReadRequestCount(size);
+		File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, requestCount, allocationTag::DECODE_SCRATCH);
+		File::ReadRequest* request = requests;
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			void* planarData = allocator->Allocate(size*bytesPerPixel, 16u);
+			void* planarData = allocator->Allocate(size, 16u, allocationTag::CHANNEL_DATA);
 			imageData->images[i].data = planarData;
 
-			reader.Read(planarData, size*bytesPerPixel);
+			request = AddReadRequests(request, static_cast<uint8_t*>(planarData), size, reader.GetPosition());
+			reader.Skip(size);
 		}
 
+		if (!ReadBatch(file, requests, requestCount))
+		{
+			PSD_ERROR("ImageData", "Could not read image data.");
+		}
+		memoryUtil::FreeArray(allocator, requests);
+
 		return imageData;
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	static ImageDataSection* ReadImageDataSectionRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel)
+	static void EndianConvertRows(void* data, size_t count, unsigned int bytesPerPixel)
 	{
-		// the RLE-compressed data is preceded by a 2-byte data count for each scan line, per channel.
-		// we store the size of the RLE data per channel, and assume a maximum of 256 channels.
+		if (bytesPerPixel == 2u)
+		{
+			endianUtil::BigEndianToNativeArray(static_cast<uint16_t*>(data), static_cast<uint16_t*>(data), count);
+		}
+		else if (bytesPerPixel == 4u)
+		{
+			endianUtil::BigEndianToNativeArray(static_cast<float32_t*>(data), static_cast<float32_t*>(data), count);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetBandHeight(unsigned int height, unsigned int threadCount)
+	{
+		if (threadCount <= 1u)
+		{
+			return height;
+		}
+
+		const unsigned int bandHeight = (height + threadCount - 1u) / threadCount;
+		return (bandHeight < MIN_BAND_HEIGHT) ? MIN_BAND_HEIGHT : bandHeight;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t* ReadRleRowOffsets(SyncFileReader& reader, Allocator* allocator, const Document* document)
+	{
+		// the RLE-compressed data is preceded by a data count for each scan line, per channel. the counts are stored in
+		// 2 bytes in .PSD files, and in 4 bytes in .PSB files.
+		// the counts give the exact offset of each row, so that rows can be decoded independently of each other.
+		const unsigned int height = document->height;
+		const unsigned int channelCount = document->channelCount;
+		const bool isLargeDocument = (document->version == 2u);
+		uint64_t* rowOffsets = memoryUtil::AllocateArray<uint64_t>(allocator, channelCount*height + 1u, allocationTag::DECODE_SCRATCH);
+		uint64_t totalSize = 0ull;
+		for (unsigned int i=0; i < channelCount*height; ++i)
+		{
+			rowOffsets[i] = totalSize;
+
+			const uint32_t dataCount = isLargeDocument
+				? fileUtil::ReadFromFileBE<uint32_t>(reader)
+				: fileUtil::ReadFromFileBE<uint16_t>(reader);
+			totalSize += dataCount;
+		}
+		rowOffsets[channelCount*height] = totalSize;
+
+		return rowOffsets;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadRleImageData(SyncFileReader& reader, File* file, Allocator* allocator, const Document* document, RleImageData& rle)
+	{
+		const unsigned int height = document->height;
+		const unsigned int channelCount = document->channelCount;
 		PSD_ASSERT(channelCount < 256, "Image data section has too many channels (%d).", channelCount);
-		unsigned int channelSize[256] = {};
-		unsigned int totalSize = 0;
+		uint64_t* rowOffsets = ReadRleRowOffsets(reader, allocator, document);
+		uint64_t channelSize[256] = {};
+		unsigned int requestCount = 0u;
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			unsigned int size = 0u;
-			for (unsigned int j=0; j < height; ++j)
+			channelSize[i] = rowOffsets[(i + 1u)*height] - rowOffsets[i*height];
+			requestCount += GetReadRequestCount(channelSize[i]);
+		}
+
+		const uint64_t totalSize = rowOffsets[channelCount*height];
+		if (totalSize == 0)
+		{
+			memoryUtil::FreeArray(allocator, rowOffsets);
+			return false;
+		}
+
+		// the RLE data of all channels is read in one batch, either directly from memory or into a single buffer
+		const uint8_t* rleData = static_cast<const uint8_t*>(file->GetData(reader.GetPosition(), totalSize));
+		uint8_t* rleBuffer = nullptr;
+		if (!rleData)
+		{
+			rleBuffer = static_cast<uint8_t*>(allocator->Allocate(static_cast<size_t>(totalSize), 16u, allocationTag::COMPRESSED_DATA));
+			rleData = rleBuffer;
+
+			File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, requestCount, allocationTag::DECODE_SCRATCH);
+			File::ReadRequest* request = requests;
+			uint64_t offset = 0ull;
+			for (unsigned int i=0; i < channelCount; ++i)
 			{
-				const uint16_t dataCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
-				size += dataCount;
+				request = AddReadRequests(request, rleBuffer + offset, channelSize[i], reader.GetPosition() + offset);
+				offset += channelSize[i];
 			}
 
-			channelSize[i] = size;
-			totalSize += size;
+			if (!ReadBatch(file, requests, requestCount))
+			{
+				PSD_ERROR("ImageData", "Could not read RLE image data.");
+			}
+			memoryUtil::FreeArray(allocator, requests);
 		}
+		reader.Skip(totalSize);
 
-		if (totalSize == 0)
+		rle.data = rleData;
+		rle.buffer = rleBuffer;
+		rle.rowOffsets = rowOffsets;
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyRleImageData(Allocator* allocator, RleImageData& rle)
+	{
+		memoryUtil::FreeArray(allocator, rle.rowOffsets);
+		memoryUtil::FreeArray(allocator, rle.buffer);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static ImageDataSection* ReadImageDataSectionRLE(SyncFileReader& reader, File* file, Allocator* allocator, const Document* document, unsigned int threadCount)
+	{
+		RleImageData rle = {};
+		if (!ReadRleImageData(reader, file, allocator, document, rle))
 			return nullptr;
 
-		const unsigned int size = width*height;
+		const unsigned int width = document->width;
+		const unsigned int height = document->height;
+		const unsigned int channelCount = document->channelCount;
+		const unsigned int bytesPerPixel = document->bitsPerChannel / 8u;
+
+		const size_t size = static_cast<size_t>(width)*height*bytesPerPixel;
 		ImageDataSection* imageData = memoryUtil::Allocate<ImageDataSection>(allocator);
 		imageData->imageCount = channelCount;
-		imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount);
+		imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount, allocationTag::LAYER_RECORDS);
 
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			void* planarData = allocator->Allocate(size*bytesPerPixel, 16u);
-			imageData->images[i].data = planarData;
+			imageData->images[i].data = allocator->Allocate(size, 16u, allocationTag::CHANNEL_DATA);
+		}
 
-			// read RLE data, and uncompress into planar buffer
-			const unsigned int rleSize = channelSize[i];
-			uint8_t* rleData = static_cast<uint8_t*>(allocator->Allocate(rleSize, 4u));
-			reader.Read(rleData, rleSize);
+		// split each channel into bands of rows, and decode all bands of all channels in parallel
+		const unsigned int bandHeight = GetBandHeight(height, threadCount);
+		const unsigned int bandCount = (height + bandHeight - 1u) / bandHeight;
+		const PlanarImage* images = imageData->images;
+		threadUtil::ParallelFor(channelCount*bandCount, threadCount, [=, &rle](unsigned int task)
+		{
+			const unsigned int channel = task / bandCount;
+			const unsigned int y = (task % bandCount) * bandHeight;
+			const unsigned int rowCount = (height - y < bandHeight) ? (height - y) : bandHeight;
 
-			imageUtil::DecompressRle(rleData, rleSize, static_cast<uint8_t*>(planarData), width*height*bytesPerPixel);
+			// uncompress RLE data into planar buffer
+			const uint64_t* rowOffsets = rle.rowOffsets + channel*height + y;
+			uint8_t* planarData = static_cast<uint8_t*>(images[channel].data) + static_cast<size_t>(y)*width*bytesPerPixel;
+			imageUtil::DecompressRle(rle.data + rowOffsets[0], static_cast<size_t>(rowOffsets[rowCount] - rowOffsets[0]), planarData, static_cast<size_t>(rowCount)*width*bytesPerPixel);
+			EndianConvertRows(planarData, static_cast<size_t>(rowCount)*width, bytesPerPixel);
+		});
 
-			allocator->Free(rleData);
-		}
+		DestroyRleImageData(allocator, rle);
 
 		return imageData;
 	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void InterleaveRow(const uint8_t* PSD_RESTRICT src, T* PSD_RESTRICT dest, unsigned int width, unsigned int channelCount)
+	{
+		// stores one row of big-endian planar data into every channelCount-th element of dest
+		for (unsigned int x=0; x < width; ++x)
+		{
+			dest[x*channelCount] = endianUtil::ReadBigEndian<T>(src + x*sizeof(T));
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void InterleaveRows(const uint8_t* data, const RleImageData* rle, uint8_t* rowBuffer, T* dest, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int y, unsigned int rowCount)
+	{
+		// decodes a band of rows of all channels, one row at a time, so that each row is interleaved while it is still in the cache
+		const unsigned int rowSize = width*sizeof(T);
+		for (unsigned int i=y; i < y + rowCount; ++i)
+		{
+			T* destRow = dest + static_cast<size_t>(i)*width*channelCount;
+			for (unsigned int channel=0; channel < channelCount; ++channel)
+			{
+				const uint8_t* row = data ? data + (static_cast<size_t>(channel)*height + i)*rowSize : nullptr;
+				if (rle)
+				{
+					const uint64_t* rowOffsets = rle->rowOffsets + channel*height + i;
+					imageUtil::DecompressRle(rle->data + rowOffsets[0], static_cast<size_t>(rowOffsets[1] - rowOffsets[0]), rowBuffer, rowSize);
+					row = rowBuffer;
+				}
+
+				InterleaveRow(row, destRow + channel, width, channelCount);
+			}
+		}
+	}
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator)
+{
+	return ParseImageDataSection(document, file, allocator, 1u);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator, unsigned int threadCount)
 {
 	PSD_ASSERT_NOT_NULL(file);
 	PSD_ASSERT_NOT_NULL(allocator);
@@ -139,9 +369,14 @@ ImageDataSection* ParseImageDataSection(const Document* document, File* file, Al
 		return nullptr;
 	}
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator);
 	reader.SetPosition(section.offset);
 
+	if (threadCount == 0u)
+	{
+		threadCount = threadUtil::GetHardwareThreadCount();
+	}
+
 	ImageDataSection* imageData = nullptr;
 	const unsigned int width = document->width;
 	const unsigned int height = document->height;
@@ -150,11 +385,14 @@ ImageDataSection* ParseImageDataSection(const Document* document, File* file, Al
 	const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
 	if (compressionType == compressionType::RAW)
 	{
-		imageData = ReadImageDataSectionRaw(reader, allocator, width, height, channelCount, bitsPerChannel / 8u);
+		imageData = ReadImageDataSectionRaw(reader, file, allocator, width, height, channelCount, bitsPerChannel / 8u);
 	}
 	else if (compressionType == compressionType::RLE)
 	{
-		imageData = ReadImageDataSectionRLE(reader, allocator, width, height, channelCount, bitsPerChannel / 8u);
+		imageData = ReadImageDataSectionRLE(reader, file, allocator, document, threadCount);
+
+		// RLE data has already been endian-converted while decoding
+		return imageData;
 	}
 	else
 	{
@@ -191,6 +429,265 @@ ImageDataSection* ParseImageDataSection(const Document* document, File* file, Al
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool ParseImageDataSectionInterleaved(const Document* document, File* file, Allocator* allocator, void* dest, unsigned int threadCount)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(dest);
+
+	const Section& section = document->imageDataSection;
+	if (section.length == 0)
+	{
+		PSD_ERROR("PSD", "Document does not contain an image data section.");
+		return false;
+	}
+
+	const unsigned int width = document->width;
+	const unsigned int height = document->height;
+	const unsigned int bitsPerChannel = document->bitsPerChannel;
+	const unsigned int channelCount = document->channelCount;
+	if ((bitsPerChannel != 8u) && (bitsPerChannel != 16u) && (bitsPerChannel != 32u))
+	{
+		PSD_ERROR("ImageData", "Unhandled bits per channel: %u.", bitsPerChannel);
+		return false;
+	}
+
+	if (threadCount == 0u)
+	{
+		threadCount = threadUtil::GetHardwareThreadCount();
+	}
+
+	SyncFileReader reader(file, allocator);
+	reader.SetPosition(section.offset);
+
+	// RAW data is interleaved straight from the file data, RLE data is decoded row by row into a buffer first
+	const unsigned int rowSize = width*bitsPerChannel / 8u;
+	const uint8_t* data = nullptr;
+	uint8_t* buffer = nullptr;
+	RleImageData rle = {};
+	const RleImageData* rowSource = nullptr;
+
+	const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
+	if (compressionType == compressionType::RAW)
+	{
+		const size_t size = static_cast<size_t>(rowSize)*height*channelCount;
+		if (size == 0)
+			return false;
+
+		data = static_cast<const uint8_t*>(file->GetData(reader.GetPosition(), size));
+		if (!data)
+		{
+			buffer = static_cast<uint8_t*>(allocator->Allocate(size, 16u, allocationTag::COMPRESSED_DATA));
+			data = buffer;
+
+			const unsigned int requestCount = GetReadRequestCount(size);
+			File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, requestCount, allocationTag::DECODE_SCRATCH);
+			AddReadRequests(requests, buffer, size, reader.GetPosition());
+			if (!ReadBatch(file, requests, requestCount))
+			{
+				PSD_ERROR("ImageData", "Could not read image data.");
+			}
+			memoryUtil::FreeArray(allocator, requests);
+		}
+	}
+	else if (compressionType == compressionType::RLE)
+	{
+		if (!ReadRleImageData(reader, file, allocator, document, rle))
+			return false;
+
+		rowSource = &rle;
+	}
+	else
+	{
+		PSD_ERROR("ImageData", "Unhandled compression type %u.", compressionType);
+		return false;
+	}
+
+	// each band of rows is decoded and interleaved independently of all other bands
+	const unsigned int bandHeight = GetBandHeight(height, threadCount);
+	const unsigned int bandCount = (height + bandHeight - 1u) / bandHeight;
+	threadUtil::ParallelFor(bandCount, threadCount, [=](unsigned int band)
+	{
+		const unsigned int y = band*bandHeight;
+		const unsigned int rowCount = (height - y < bandHeight) ? (height - y) : bandHeight;
+
+		uint8_t* rowBuffer = rowSource ? static_cast<uint8_t*>(allocator->Allocate(rowSize, 16u, allocationTag::DECODE_SCRATCH)) : nullptr;
+		if (bitsPerChannel == 8u)
+		{
+			InterleaveRows(data, rowSource, rowBuffer, static_cast<uint8_t*>(dest), width, height, channelCount, y, rowCount);
+		}
+		else if (bitsPerChannel == 16u)
+		{
+			InterleaveRows(data, rowSource, rowBuffer, static_cast<uint16_t*>(dest), width, height, channelCount, y, rowCount);
+		}
+		else
+		{
+			InterleaveRows(data, rowSource, rowBuffer, static_cast<float32_t*>(dest), width, height, channelCount, y, rowCount);
+		}
+		allocator->Free(rowBuffer);
+	});
+
+	if (rowSource)
+	{
+		DestroyRleImageData(allocator, rle);
+	}
+	allocator->Free(buffer);
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ImageDataSection* ParseImageDataSectionRegion(const Document* document, File* file, Allocator* allocator, int left, int top, int right, int bottom)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	const Section& section = document->imageDataSection;
+	if (section.length == 0)
+	{
+		PSD_ERROR("PSD", "Document does not contain an image data section.");
+		return nullptr;
+	}
+
+	if ((right <= left) || (bottom <= top))
+	{
+		PSD_ERROR("ImageData", "Region (%d, %d, %d, %d) is empty.", left, top, right, bottom);
+		return nullptr;
+	}
+
+	const unsigned int width = document->width;
+	const unsigned int height = document->height;
+	const unsigned int bytesPerPixel = document->bitsPerChannel / 8u;
+	const unsigned int channelCount = document->channelCount;
+	const unsigned int rowSize = width*bytesPerPixel;
+
+	SyncFileReader reader(file, allocator);
+	reader.SetPosition(section.offset);
+
+	const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
+	if ((compressionType != compressionType::RAW) && (compressionType != compressionType::RLE))
+	{
+		PSD_ERROR("ImageData", "Unhandled compression type %u.", compressionType);
+		return nullptr;
+	}
+
+	// pixels of the region that lie outside of the canvas are set to zero
+	const unsigned int regionWidth = static_cast<unsigned int>(right - left);
+	const unsigned int regionHeight = static_cast<unsigned int>(bottom - top);
+	ImageDataSection* imageData = memoryUtil::Allocate<ImageDataSection>(allocator);
+	imageData->imageCount = channelCount;
+	imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount, allocationTag::LAYER_RECORDS);
+	const size_t regionSize = static_cast<size_t>(regionWidth)*regionHeight*bytesPerPixel;
+	for (unsigned int i=0; i < channelCount; ++i)
+	{
+		imageData->images[i].data = allocator->Allocate(regionSize, 16u, allocationTag::CHANNEL_DATA);
+		memset(imageData->images[i].data, 0, regionSize);
+	}
+
+	const int clippedLeft = (left > 0) ? left : 0;
+	const int clippedTop = (top > 0) ? top : 0;
+	const int clippedRight = (right < static_cast<int>(width)) ? right : static_cast<int>(width);
+	const int clippedBottom = (bottom < static_cast<int>(height)) ? bottom : static_cast<int>(height);
+	if ((clippedRight <= clippedLeft) || (clippedBottom <= clippedTop))
+	{
+		return imageData;
+	}
+
+	const unsigned int firstRow = static_cast<unsigned int>(clippedTop);
+	const unsigned int rowCount = static_cast<unsigned int>(clippedBottom - clippedTop);
+	const unsigned int columnOffset = static_cast<unsigned int>(clippedLeft)*bytesPerPixel;
+	const unsigned int columnSize = static_cast<unsigned int>(clippedRight - clippedLeft)*bytesPerPixel;
+	const size_t destOffset = (static_cast<size_t>(clippedTop - top)*regionWidth + static_cast<size_t>(clippedLeft - left))*bytesPerPixel;
+	const size_t destRowSize = static_cast<size_t>(regionWidth)*bytesPerPixel;
+
+	if (compressionType == compressionType::RAW)
+	{
+		// RAW data is read straight into the region, one request per row and channel
+		const unsigned int requestCount = channelCount*rowCount;
+		File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, requestCount, allocationTag::DECODE_SCRATCH);
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			uint8_t* dest = static_cast<uint8_t*>(imageData->images[i].data) + destOffset;
+			for (unsigned int j=0; j < rowCount; ++j)
+			{
+				File::ReadRequest& request = requests[i*rowCount + j];
+				request.buffer = dest + j*destRowSize;
+				request.count = columnSize;
+				request.position = reader.GetPosition() + (static_cast<uint64_t>(i)*height + firstRow + j)*rowSize + columnOffset;
+			}
+		}
+
+		if (!ReadBatch(file, requests, requestCount))
+		{
+			PSD_ERROR("ImageData", "Could not read image data.");
+		}
+		memoryUtil::FreeArray(allocator, requests);
+	}
+	else
+	{
+		// only the RLE data of the rows intersecting the region is read, and decoded one row at a time
+		uint64_t* rowOffsets = ReadRleRowOffsets(reader, allocator, document);
+		uint8_t* rowBuffer = static_cast<uint8_t*>(allocator->Allocate(rowSize, 16u, allocationTag::DECODE_SCRATCH));
+		uint64_t bufferSize = 0ull;
+		unsigned int requestCount = 0u;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const uint64_t size = rowOffsets[i*height + firstRow + rowCount] - rowOffsets[i*height + firstRow];
+			bufferSize += size;
+			requestCount += GetReadRequestCount(size);
+		}
+
+		uint8_t* rleBuffer = static_cast<uint8_t*>(allocator->Allocate(static_cast<size_t>(bufferSize), 16u, allocationTag::COMPRESSED_DATA));
+		File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, requestCount, allocationTag::DECODE_SCRATCH);
+		File::ReadRequest* request = requests;
+		uint64_t offset = 0ull;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const uint64_t* channelOffsets = rowOffsets + i*height + firstRow;
+			const uint64_t size = channelOffsets[rowCount] - channelOffsets[0];
+			request = AddReadRequests(request, rleBuffer + offset, size, reader.GetPosition() + channelOffsets[0]);
+			offset += size;
+		}
+
+		if (!ReadBatch(file, requests, requestCount))
+		{
+			PSD_ERROR("ImageData", "Could not read RLE image data.");
+		}
+
+		const uint8_t* rleData = rleBuffer;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const uint64_t* channelOffsets = rowOffsets + i*height + firstRow;
+			uint8_t* dest = static_cast<uint8_t*>(imageData->images[i].data) + destOffset;
+			for (unsigned int j=0; j < rowCount; ++j)
+			{
+				imageUtil::DecompressRle(rleData + (channelOffsets[j] - channelOffsets[0]), static_cast<size_t>(channelOffsets[j + 1u] - channelOffsets[j]), rowBuffer, rowSize);
+				memcpy(dest + j*destRowSize, rowBuffer + columnOffset, columnSize);
+			}
+
+			rleData += channelOffsets[rowCount] - channelOffsets[0];
+		}
+
+		memoryUtil::FreeArray(allocator, requests);
+		allocator->Free(rleBuffer);
+		allocator->Free(rowBuffer);
+		memoryUtil::FreeArray(allocator, rowOffsets);
+	}
+
+	// endian-convert the region
+	for (unsigned int i=0; i < channelCount; ++i)
+	{
+		EndianConvertRows(imageData->images[i].data, static_cast<size_t>(regionWidth)*regionHeight, bytesPerPixel);
+	}
+
+	return imageData;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void DestroyImageDataSection(ImageDataSection*& section, Allocator* allocator)
@@ -19,6 +19,29 @@ struct ImageDataSection;
 /// or \ref ParseLayerMaskSection) in parallel from different threads.
 ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator);
 
+/// \ingroup Parser
+/// Parses the image data section like \ref ParseImageDataSection, but decodes RLE-compressed data using up to \a threadCount threads
+/// including the calling thread. Each channel is split into bands of rows that are decoded independently, using the scan line table.
+/// A \a threadCount of 0 uses all hardware threads.
+/// \remark If \a threadCount is not 1, \a allocator is used from multiple threads concurrently, and must therefore be thread-safe.
+ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator, unsigned int threadCount);
+
+/// \ingroup Parser
+/// Decodes the image data section directly into the caller-provided buffer \a dest, storing the values of all channels interleaved
+/// in native-endian order and in the order they are stored in the document, e.g. RGBRGB... for RGB documents without alpha channels.
+/// \a dest must hold "width*height*channelCount*bitsPerChannel/8" bytes. Bands of rows are decoded and interleaved in parallel
+/// using up to \a threadCount threads including the calling thread, with a \a threadCount of 0 using all hardware threads.
+/// Returns false if the section does not exist or its data cannot be decoded.
+/// \remark If \a threadCount is not 1, \a allocator is used from multiple threads concurrently, and must therefore be thread-safe.
+bool ParseImageDataSectionInterleaved(const Document* document, File* file, Allocator* allocator, void* dest, unsigned int threadCount);
+
+/// \ingroup Parser
+/// Parses the part of the image data section that lies inside the region given by \a left, \a top, \a right and \a bottom,
+/// and returns a newly created instance holding one planar image of the region's size per channel, which needs to be freed
+/// by a call to \ref DestroyImageDataSection. Only the rows intersecting the region are read from the file and decoded.
+/// Pixels of the region that lie outside of the canvas are set to zero. Returns nullptr if the region is empty.
+ImageDataSection* ParseImageDataSectionRegion(const Document* document, File* file, Allocator* allocator, int left, int top, int right, int bottom);
+
 /// \ingroup Parser
 /// Destroys and nullifies the given \a section previously created by a call to \ref ParseImageDataSection.
 void DestroyImageDataSection(ImageDataSection*& section, Allocator* allocator);
@@ -15,6 +15,7 @@
 #include "PsdSyncFileUtil.h"
 #include "PsdMemoryUtil.h"
 #include "PsdAllocator.h"
+#include "PsdAllocationTag.h"
 #include "PsdLog.h"
 
 
@@ -38,7 +39,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 	imageResources->xmpMetadata = nullptr;
 	imageResources->thumbnail = nullptr;
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator);
 	reader.SetPosition(document->imageResourcesSection.offset);
 
 	int64_t leftToRead = document->imageResourcesSection.length;
@@ -93,7 +94,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 					// note that this assumes RGB mode
 					const unsigned int channelCount = document->channelCount - 3;
 					imageResources->alphaChannelCount = channelCount;
-					imageResources->alphaChannels = memoryUtil::AllocateArray<AlphaChannel>(allocator, channelCount);
+					imageResources->alphaChannels = memoryUtil::AllocateArray<AlphaChannel>(allocator, channelCount, allocationTag::IMAGE_RESOURCES);
 				}
 
 				const uint32_t version = fileUtil::ReadFromFileBE<uint32_t>(reader);
@@ -180,7 +181,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 				thumbnail->width = width;
 				thumbnail->height = height;
 				thumbnail->binaryJpegSize = binaryJpegSize;
-				thumbnail->binaryJpeg = memoryUtil::AllocateArray<uint8_t>(allocator, binaryJpegSize);
+				thumbnail->binaryJpeg = memoryUtil::AllocateArray<uint8_t>(allocator, binaryJpegSize, allocationTag::IMAGE_RESOURCES);
 
 				reader.Read(thumbnail->binaryJpeg, binaryJpegSize);
 			}
@@ -190,7 +191,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 			{
 				// load the XMP metadata as raw data
 				PSD_ASSERT(!imageResources->xmpMetadata, "File contains more than one XMP metadata resource.");
-				imageResources->xmpMetadata = memoryUtil::AllocateArray<char>(allocator, resourceSize);
+				imageResources->xmpMetadata = memoryUtil::AllocateArray<char>(allocator, resourceSize, allocationTag::IMAGE_RESOURCES);
 				reader.Read(imageResources->xmpMetadata, resourceSize);
 			}
 			break;
@@ -199,7 +200,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 			{
 				// load the ICC profile as raw data
 				PSD_ASSERT(!imageResources->iccProfile, "File contains more than one ICC profile.");
-				imageResources->iccProfile = memoryUtil::AllocateArray<uint8_t>(allocator, resourceSize);
+				imageResources->iccProfile = memoryUtil::AllocateArray<uint8_t>(allocator, resourceSize, allocationTag::IMAGE_RESOURCES);
 				imageResources->sizeOfICCProfile = resourceSize;
 				reader.Read(imageResources->iccProfile, resourceSize);
 			}
@@ -209,7 +210,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 			{
 				// load the EXIF data as raw data
 				PSD_ASSERT(!imageResources->exifData, "File contains more than one EXIF data block.");
-				imageResources->exifData = memoryUtil::AllocateArray<uint8_t>(allocator, resourceSize);
+				imageResources->exifData = memoryUtil::AllocateArray<uint8_t>(allocator, resourceSize, allocationTag::IMAGE_RESOURCES);
 				imageResources->sizeOfExifData = resourceSize;
 				reader.Read(imageResources->exifData, resourceSize);
 			}
@@ -224,7 +225,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 					// note that this assumes RGB mode
 					const unsigned int channelCount = document->channelCount - 3;
 					imageResources->alphaChannelCount = channelCount;
-					imageResources->alphaChannels = memoryUtil::AllocateArray<AlphaChannel>(allocator, channelCount);
+					imageResources->alphaChannels = memoryUtil::AllocateArray<AlphaChannel>(allocator, channelCount, allocationTag::IMAGE_RESOURCES);
 				}
 
 				// the names of the alpha channels are stored as a series of Pascal strings
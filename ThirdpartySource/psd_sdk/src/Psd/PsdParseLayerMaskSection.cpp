@@ -11,8 +11,10 @@
 #include "PsdLayerMask.h"
 #include "PsdVectorMask.h"
 #include "PsdCompressionType.h"
+#include "PsdDecodeContext.h"
 #include "PsdLayerType.h"
 #include "PsdFile.h"
+#include "PsdRowSink.h"
 #include "PsdLayerMaskSection.h"
 #include "PsdKey.h"
 #include "PsdBitUtil.h"
@@ -20,18 +22,29 @@
 #include "PsdSyncFileReader.h"
 #include "PsdSyncFileUtil.h"
 #include "PsdMemoryUtil.h"
+#include "PsdThreadUtil.h"
 #include "PsdDecompressRle.h"
+#include "PsdInflate.h"
+#include "PsdPrediction.h"
 #include "PsdAllocator.h"
-#include "Psdminiz.h"
+#include "PsdAllocationTag.h"
 #include "Psdinttypes.h"
 #include "PsdLog.h"
 #include <cstring>
+#include <algorithm>
 
 
 PSD_NAMESPACE_BEGIN
 
 namespace
 {
+	// bands of RLE-compressed rows smaller than this are not worth handing to a separate thread
+	static const unsigned int MIN_RLE_BAND_HEIGHT = 64u;
+
+	// the number of rows that are read from the file at once when streaming rows into a sink
+	static const unsigned int STREAM_BAND_HEIGHT = 64u;
+
+
 	struct MaskData
 	{
 		int32_t top;
@@ -249,25 +262,26 @@ namespace
 		PSD_ASSERT_NOT_NULL(src);
 
 		T* data = static_cast<T*>(src);
-		const unsigned int size = width*height;
-
-		for (unsigned int i=0; i < size; ++i)
-		{
-			data[i] = endianUtil::BigEndianToNative(data[i]);
-		}
+		endianUtil::BigEndianToNativeArray(data, data, static_cast<size_t>(width)*height);
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	static void* ReadChannelDataRaw(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height)
+	static void* DecodeChannelDataRaw(const uint8_t* src, uint32_t srcSize, Allocator* allocator, unsigned int width, unsigned int height)
 	{
-		const unsigned int size = width*height;
+		const size_t size = static_cast<size_t>(width)*height*sizeof(T);
 		if (size > 0)
 		{
-			void* planarData = allocator->Allocate(size*sizeof(T), 16u);
-			reader.Read(planarData, size*sizeof(T));
+			if (srcSize < size)
+			{
+				PSD_ERROR("PsdExtract", "Raw channel data is too small, expected %" PRIu64 " bytes but got %u.", static_cast<uint64_t>(size), srcSize);
+				return nullptr;
+			}
+
+			void* planarData = allocator->Allocate(size, 16u, allocationTag::CHANNEL_DATA);
+			memcpy(planarData, src, size);
 
 			EndianConvert<T>(planarData, width, height);
 
@@ -280,32 +294,124 @@ namespace
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	static void* ReadChannelDataRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height)
+	static bool BorrowChannelDataRaw(Channel* channel, const uint8_t* src, unsigned int width, unsigned int height)
+	{
+		// 8-bit RAW data is stored exactly like the planar data it would be decoded to, so it can be used in-place.
+		// masks are moved to structures that always own their data, so only color channels and the transparency mask are borrowed.
+		if ((channel->type < channelType::TRANSPARENCY_MASK) || (endianUtil::ReadBigEndian<uint16_t>(src) != compressionType::RAW))
+		{
+			return false;
+		}
+
+		// data that is too small is left to the regular path, which reports the error
+		const uint64_t size = static_cast<uint64_t>(width)*height;
+		if ((size == 0u) || (channel->size - sizeof(uint16_t) < size))
+		{
+			return false;
+		}
+
+		channel->data = const_cast<uint8_t*>(src + sizeof(uint16_t));
+		channel->isDataBorrowed = true;
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetRleRowCountSize(const Document* document)
+	{
+		// the scan line table stores the size of each RLE-compressed row in 2 bytes in .PSD files, and in 4 bytes in .PSB files
+		return (document->version == 2u) ? sizeof(uint32_t) : sizeof(uint16_t);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static PSD_INLINE uint32_t ReadRleRowSize(const uint8_t* rowTable, unsigned int row, unsigned int rowCountSize)
+	{
+		return (rowCountSize == sizeof(uint32_t))
+			? endianUtil::ReadBigEndian<uint32_t>(rowTable + row*sizeof(uint32_t))
+			: endianUtil::ReadBigEndian<uint16_t>(rowTable + row*sizeof(uint16_t));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool GetRleDataSize(const uint8_t* src, uint32_t srcSize, unsigned int height, unsigned int rowCountSize, uint32_t& rleDataSize)
 	{
-		// the RLE-compressed data is preceded by a 2-byte data count for each scan line
-		const unsigned int size = width*height;
+		// the RLE-compressed data is preceded by a data count for each scan line
+		const uint32_t rowTableSize = height*rowCountSize;
+		if (srcSize < rowTableSize)
+		{
+			PSD_ERROR("PsdExtract", "RLE channel data is too small to hold the scan line table.");
+			return false;
+		}
 
-		unsigned int rleDataSize = 0u;
+		// 4-byte counts can add up to more than 32 bits in malformed files
+		uint64_t dataSize = 0ull;
 		for (unsigned int i=0; i < height; ++i)
 		{
-			const uint16_t dataCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
-			rleDataSize += dataCount;
+			dataSize += ReadRleRowSize(src, i, rowCountSize);
 		}
 
-		if (rleDataSize > 0)
+		if (dataSize > srcSize - rowTableSize)
 		{
-			void* planarData = allocator->Allocate(size*sizeof(T), 16u);
+			PSD_ERROR("PsdExtract", "RLE channel data is truncated, expected %" PRIu64 " bytes but got %u.", dataSize, srcSize - rowTableSize);
+			dataSize = srcSize - rowTableSize;
+		}
 
-			// decompress RLE
-			void* rleData = allocator->Allocate(rleDataSize, 4u);
-			{
-				reader.Read(rleData, rleDataSize);
-				imageUtil::DecompressRle(static_cast<const uint8_t*>(rleData), rleDataSize, static_cast<uint8_t*>(planarData), width*height*sizeof(T));
-			}
-			allocator->Free(rleData);
+		rleDataSize = static_cast<uint32_t>(dataSize);
+		return true;
+	}
 
-			EndianConvert<T>(planarData, width, height);
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void DecodeRowsRLE(const uint8_t* src, uint32_t srcSize, void* dest, unsigned int width, unsigned int rowCount)
+	{
+		imageUtil::DecompressRle(src, srcSize, static_cast<uint8_t*>(dest), static_cast<size_t>(width)*rowCount*sizeof(T));
+
+		EndianConvert<T>(dest, width, rowCount);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DecodeRowsRLE(const Document* document, const uint8_t* src, uint32_t srcSize, void* dest, unsigned int width, unsigned int rowCount)
+	{
+		if (document->bitsPerChannel == 8)
+		{
+			DecodeRowsRLE<uint8_t>(src, srcSize, dest, width, rowCount);
+		}
+		else if (document->bitsPerChannel == 16)
+		{
+			DecodeRowsRLE<uint16_t>(src, srcSize, dest, width, rowCount);
+		}
+		else if (document->bitsPerChannel == 32)
+		{
+			DecodeRowsRLE<float32_t>(src, srcSize, dest, width, rowCount);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void* DecodeChannelDataRLE(const uint8_t* src, uint32_t srcSize, Allocator* allocator, unsigned int width, unsigned int height, unsigned int rowCountSize)
+	{
+		uint32_t rleDataSize = 0u;
+		if (!GetRleDataSize(src, srcSize, height, rowCountSize, rleDataSize))
+		{
+			return nullptr;
+		}
+
+		if (rleDataSize > 0)
+		{
+			void* planarData = allocator->Allocate(static_cast<size_t>(width)*height*sizeof(T), 16u, allocationTag::CHANNEL_DATA);
+
+			// decompress RLE straight from the channel data
+			DecodeRowsRLE<T>(src + height*rowCountSize, rleDataSize, planarData, width, height);
 
 			return planarData;
 		}
@@ -317,26 +423,20 @@ namespace
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	static void* ReadChannelDataZip(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, uint32_t channelSize)
+	static void* DecodeChannelDataZip(const uint8_t* src, uint32_t srcSize, Allocator* allocator, unsigned int width, unsigned int height)
 	{
-		if (channelSize > 0)
+		if (srcSize > 0)
 		{
-			const unsigned int size = width*height;
-
-			T* planarData = static_cast<T*>(allocator->Allocate(size*sizeof(T), 16));
+			const size_t size = static_cast<size_t>(width)*height*sizeof(T);
 
-			void* zipData = allocator->Allocate(channelSize, 4u);
-			reader.Read(zipData, channelSize);
+			T* planarData = static_cast<T*>(allocator->Allocate(size, 16u, allocationTag::CHANNEL_DATA));
 
 			// the zipped data stream has a zlib-header
-			const size_t status = tinfl_decompress_mem_to_mem(planarData, size*sizeof(T), zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
-			if (status == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED)
+			if (!imageUtil::Inflate(src, srcSize, reinterpret_cast<uint8_t*>(planarData), size))
 			{
 				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
 			}
 
-			allocator->Free(zipData);
-
 			EndianConvert<T>(planarData, width, height);
 
 			return planarData;
@@ -348,144 +448,97 @@ namespace
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	static void ApplyPrediction(Allocator* allocator, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	static void* GetScratchBuffer(Allocator* allocator, DecodeContext* context, decodeBuffer::Enum buffer, size_t size)
 	{
-		static_assert(sizeof(T) == -1, "Unknown data type.");
+		// without a context, scratch memory is allocated for each use and freed again by ReleaseScratchBuffer.
+		// buffers held by a context only ever grow, so they are reused by all subsequent layers of similar size.
+		if (!context)
+		{
+			return allocator->Allocate(size, 16u, allocationTag::DECODE_SCRATCH);
+		}
+
+		if (context->sizes[buffer] < size)
+		{
+			allocator->Free(context->buffers[buffer]);
+			context->buffers[buffer] = allocator->Allocate(size, 16u, allocationTag::DECODE_SCRATCH);
+			context->sizes[buffer] = size;
+		}
+
+		return context->buffers[buffer];
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <>
-	void ApplyPrediction<uint8_t>(Allocator*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	static void ReleaseScratchBuffer(Allocator* allocator, DecodeContext* context, void* ptr)
 	{
-		uint8_t* buffer = static_cast<uint8_t*>(planarData);
-		for (unsigned int y = 0; y < height; ++y)
+		if (!context)
 		{
-			++buffer;
-			for (unsigned int x = 1; x < width; ++x)
-			{
-				const uint32_t previous = buffer[-1];
-				const uint32_t current = buffer[0];
-				const uint32_t value = current + previous;
-
-				*buffer++ = static_cast<uint8_t>(value & 0xFFu);
-			}
+			allocator->Free(ptr);
 		}
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <>
-	void ApplyPrediction<uint16_t>(Allocator*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	template <typename T>
+	static void ApplyPrediction(Allocator* allocator, DecodeContext* context, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
-		// 16-bit images are delta-encoded word-by-word.
-		// the deltas are big-endian and must be reversed first for further processing. note that this is done
-		// in-place with the delta-decoding.
-		{
-			uint16_t* buffer = static_cast<uint16_t*>(planarData);
-			for (unsigned int y=0; y < height; ++y)
-			{
-				const uint16_t first = *buffer;
-				*buffer++ = endianUtil::BigEndianToNative(first);
-				for (unsigned int x=1; x < width; ++x)
-				{
-					buffer[0] = endianUtil::BigEndianToNative(buffer[0]);
-
-					const uint32_t previous = buffer[-1];
-					const uint32_t current = buffer[0];
-					const uint32_t value = current + previous;
-
-					// note that the data written here is now in little-endian format
-					*buffer++ = static_cast<uint16_t>(value & 0xFFFFu);
-				}
-			}
-		}
+		static_assert(sizeof(T) == -1, "Unknown data type.");
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <>
-	void ApplyPrediction<float32_t>(Allocator* allocator, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	void ApplyPrediction<uint8_t>(Allocator*, DecodeContext*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
-		// delta-decode row by row first
-		{
-			uint8_t* buffer = static_cast<uint8_t*>(planarData);
-			for (unsigned int y=0; y < height; ++y)
-			{
-				++buffer;
-				for (unsigned int x=1; x < width*4; ++x)
-				{
-					const uint32_t previous = buffer[-1];
-					const uint32_t current = buffer[0];
-					const uint32_t value = current + previous;
-
-					*buffer++ = static_cast<uint8_t>(value & 0xFFu);
-				}
-			}
-		}
+		imageUtil::ApplyPrediction(static_cast<uint8_t*>(planarData), width, height);
+	}
 
-		// the bytes of the 32-bit float are stored in planar fashion per row, big-endian format.
-		// interleave the bytes, and store them in little-endian format at the same time.
-		uint8_t* rowData = static_cast<uint8_t*>(allocator->Allocate(width*sizeof(float32_t), 16));
-		{
-			uint8_t* dest = static_cast<uint8_t*>(planarData);
-			for (unsigned int y=0; y < height; ++y)
-			{
-				// copy first row of data to backup storage, because it will be overwritten inside our loop.
-				// note that this operation cannot be done in-place, that's why we work row by row.
-				memcpy(rowData, dest, width*sizeof(float32_t));
 
-				const uint8_t* src0 = rowData;
-				const uint8_t* src1 = rowData + 1*width;
-				const uint8_t* src2 = rowData + 2*width;
-				const uint8_t* src3 = rowData + 3*width;
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	void ApplyPrediction<uint16_t>(Allocator*, DecodeContext*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	{
+		// note that the data written here is in native-endian format
+		imageUtil::ApplyPrediction(static_cast<uint16_t*>(planarData), width, height);
+	}
 
-				for (unsigned int x=0; x < width; ++x)
-				{
-					// write data in little-endian format
-					dest[0] = *src3++;
-					dest[1] = *src2++;
-					dest[2] = *src1++;
-					dest[3] = *src0++;
-					dest += 4u;
-				}
-			}
-		}
 
-		allocator->Free(rowData);
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	void ApplyPrediction<float32_t>(Allocator* allocator, DecodeContext* context, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	{
+		// the planes of each row cannot be interleaved in-place, so they need backup storage
+		uint8_t* rowData = static_cast<uint8_t*>(GetScratchBuffer(allocator, context, decodeBuffer::ROW_DATA, width*sizeof(float32_t)));
+		imageUtil::ApplyPrediction(static_cast<float32_t*>(planarData), rowData, width, height);
+		ReleaseScratchBuffer(allocator, context, rowData);
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	static void* ReadChannelDataZipPrediction(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, uint32_t channelSize)
+	static void* DecodeChannelDataZipPrediction(const uint8_t* src, uint32_t srcSize, Allocator* allocator, DecodeContext* context, unsigned int width, unsigned int height)
 	{
-		if (channelSize > 0)
+		if (srcSize > 0)
 		{
-			const unsigned int size = width*height;
-
-			T* planarData = static_cast<T*>(allocator->Allocate(size*sizeof(T), 16));
+			const size_t size = static_cast<size_t>(width)*height*sizeof(T);
 
-			void* zipData = allocator->Allocate(channelSize, 4u);
-			reader.Read(zipData, channelSize);
+			T* planarData = static_cast<T*>(allocator->Allocate(size, 16u, allocationTag::CHANNEL_DATA));
 
 			// the zipped data stream has a zlib-header
-			const size_t status = tinfl_decompress_mem_to_mem(planarData, size*sizeof(T), zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
-			if (status == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED)
+			if (!imageUtil::Inflate(src, srcSize, reinterpret_cast<uint8_t*>(planarData), size))
 			{
 				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
 			}
 
-			allocator->Free(zipData);
-
 			// the data generated by applying the prediction data is already in little-endian format, so it doesn't have to be
 			// endian converted further.
-			ApplyPrediction<T>(allocator, planarData, width, height);
+			ApplyPrediction<T>(allocator, context, planarData, width, height);
 
 			return planarData;
 		}
@@ -496,576 +549,1912 @@ namespace
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	static LayerMaskSection* ParseLayer(const Document* document, SyncFileReader& reader, Allocator* allocator, uint64_t sectionOffset, uint32_t sectionLength, uint32_t layerLength)
+	template <typename T>
+	static void* DecodeChannelData(uint16_t compressionType, const uint8_t* src, uint32_t srcSize, Allocator* allocator, DecodeContext* context, unsigned int width, unsigned int height, unsigned int rowCountSize)
 	{
-		LayerMaskSection* layerMaskSection = memoryUtil::Allocate<LayerMaskSection>(allocator);
-		layerMaskSection->layers = nullptr;
-		layerMaskSection->layerCount = 0u;
-		layerMaskSection->overlayColorSpace = 0u;
-		layerMaskSection->opacity = 0u;
-		layerMaskSection->kind = 128u;
-		layerMaskSection->hasTransparencyMask = false;
-
-		if (layerLength != 0)
+		if (compressionType == compressionType::RAW)
 		{
-			// read the layer count. if it is a negative number, its absolute value is the number of layers and the 
-			// first alpha channel contains the transparency data for the merged result.
-			// this will also be reflected in the channelCount of the document.
-			int16_t layerCount = fileUtil::ReadFromFileBE<int16_t>(reader);
-			layerMaskSection->hasTransparencyMask = (layerCount < 0);
-			if (layerCount < 0)
-				layerCount = -layerCount;
+			return DecodeChannelDataRaw<T>(src, srcSize, allocator, width, height);
+		}
+		else if (compressionType == compressionType::RLE)
+		{
+			return DecodeChannelDataRLE<T>(src, srcSize, allocator, width, height, rowCountSize);
+		}
+		else if (compressionType == compressionType::ZIP)
+		{
+			return DecodeChannelDataZip<T>(src, srcSize, allocator, width, height);
+		}
+		else if (compressionType == compressionType::ZIP_WITH_PREDICTION)
+		{
+			return DecodeChannelDataZipPrediction<T>(src, srcSize, allocator, context, width, height);
+		}
 
-			layerMaskSection->layerCount = static_cast<unsigned int>(layerCount);
-			layerMaskSection->layers = memoryUtil::AllocateArray<Layer>(allocator, layerMaskSection->layerCount);
+		PSD_ASSERT(false, "Unsupported compression type %d", compressionType);
+		return nullptr;
+	}
 
-			// read layer record for each layer
-			for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void* DecodeChannelData(const Document* document, uint16_t compressionType, const uint8_t* src, uint32_t srcSize, Allocator* allocator, DecodeContext* context, unsigned int width, unsigned int height)
+	{
+		const unsigned int rowCountSize = GetRleRowCountSize(document);
+		if (document->bitsPerChannel == 8)
+		{
+			return DecodeChannelData<uint8_t>(compressionType, src, srcSize, allocator, context, width, height, rowCountSize);
+		}
+		else if (document->bitsPerChannel == 16)
+		{
+			return DecodeChannelData<uint16_t>(compressionType, src, srcSize, allocator, context, width, height, rowCountSize);
+		}
+		else if (document->bitsPerChannel == 32)
+		{
+			// note that this is NOT a bug.
+			// in 32-bit mode, Photoshop always interprets ZIP compression as being ZIP_WITH_PREDICTION, presumably to get better compression when writing files.
+			if (compressionType == compressionType::ZIP)
 			{
-				Layer* layer = &layerMaskSection->layers[i];
-				layer->parent = nullptr;
-				layer->utf16Name = nullptr;
-				layer->layerMask = nullptr;
-				layer->vectorMask = nullptr;
-				layer->type = layerType::ANY;
-				layer->isPassThrough = false;
+				compressionType = compressionType::ZIP_WITH_PREDICTION;
+			}
 
-				layer->top = fileUtil::ReadFromFileBE<int32_t>(reader);
-				layer->left = fileUtil::ReadFromFileBE<int32_t>(reader);
-				layer->bottom = fileUtil::ReadFromFileBE<int32_t>(reader);
-				layer->right = fileUtil::ReadFromFileBE<int32_t>(reader);
+			return DecodeChannelData<float32_t>(compressionType, src, srcSize, allocator, context, width, height, rowCountSize);
+		}
 
-				// number of channels in the layer.
-				// this includes channels for transparency, layer, and vector masks, if any.
-				const uint16_t channelCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
-				layer->channelCount = channelCount;
-				layer->channels = memoryUtil::AllocateArray<Channel>(allocator, channelCount);
+		return nullptr;
+	}
 
-				// parse each channel
-				for (unsigned int j=0; j < channelCount; ++j)
-				{
-					Channel* channel = &layer->channels[j];
-					channel->fileOffset = 0ull;
-					channel->data = nullptr;
-					channel->type = fileUtil::ReadFromFileBE<int16_t>(reader);
-					channel->size = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				}
 
-				// blend mode signature must be '8BIM'
-				const uint32_t blendModeSignature = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				if (blendModeSignature != util::Key<'8', 'B', 'I', 'M'>::VALUE)
-				{
-					PSD_ERROR("LayerMaskSection", "Layer mask info section seems to be corrupt, signature does not match \"8BIM\".");
-					return layerMaskSection;
-				}
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadChannelSources(File* file, Allocator* allocator, DecodeContext* context, const Layer* layer, const uint8_t** channelSources, uint8_t*& channelBuffer)
+	{
+		// the data of all channels is stored back-to-back in the file, and starts with a 2-byte compression type.
+		// if the file is not accessible in memory, all channels are read in one batch into a single scratch buffer that needs
+		// to be released by the caller.
+		const unsigned int channelCount = layer->channelCount;
+		uint64_t totalSize = 0ull;
+		bool isInMemory = true;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const Channel* channel = &layer->channels[i];
+			channelSources[i] = static_cast<const uint8_t*>(file->GetData(channel->fileOffset, channel->size));
+			isInMemory &= (channelSources[i] != nullptr);
+			totalSize += channel->size;
+		}
 
-				layer->blendModeKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				layer->opacity = fileUtil::ReadFromFileBE<uint8_t>(reader);
-				layer->clipping = fileUtil::ReadFromFileBE<uint8_t>(reader);
+		channelBuffer = nullptr;
+		if (isInMemory)
+		{
+			return true;
+		}
 
-				// extract flag information into layer struct
-				{
-					const uint8_t flags = fileUtil::ReadFromFileBE<uint8_t>(reader);
-					layer->isVisible = !((flags & (1u << 1)) != 0);
-				}
+		channelBuffer = static_cast<uint8_t*>(GetScratchBuffer(allocator, context, decodeBuffer::CHANNEL_DATA, static_cast<size_t>(totalSize)));
+		File::ReadRequest* requests = memoryUtil::AllocateArray<File::ReadRequest>(allocator, channelCount, allocationTag::DECODE_SCRATCH);
 
-				// skip filler byte
-				{
-					const uint8_t filler = fileUtil::ReadFromFileBE<uint8_t>(reader);
-					PSD_UNUSED(filler);
-				}
+		uint8_t* buffer = channelBuffer;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const Channel* channel = &layer->channels[i];
+			requests[i].buffer = buffer;
+			requests[i].count = static_cast<uint32_t>(channel->size);
+			requests[i].position = channel->fileOffset;
 
-				const uint32_t extraDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				const uint32_t layerMaskDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-
-				// the layer mask data section is weird. it may contain extra data for masks, such as density and feather parameters.
-				// there are 3 main possibilities:
-				//	*) length == zero		->	skip this section
-				//	*) length == [20, 28]	->	there is one mask, and that could be either a layer or vector mask.
-				//								the mask flags give rise to mask parameters. they store the mask type, and additional parameters, if any.
-				//								there might be some padding at the end of this section, and its size depends on which parameters are there.
-				//	*) length == [36, 56]	->	there are two masks. the first mask has parameters, but does NOT store flags yet.
-				//								instead, there comes a second section with the same info (flags, default color, rectangle), and
-				//								the parameters follow after that. there is also padding at the end of this second section.
-				if (layerMaskDataLength != 0)
-				{
-					// there can be at most two masks, one layer and one vector mask
-					MaskData maskData[2] = {};
-					unsigned int maskCount = 1u;
+			channelSources[i] = buffer;
+			buffer += channel->size;
+		}
 
-					float64_t layerFeather = 0.0;
-					float64_t vectorFeather = 0.0;
-					uint8_t layerDensity = 0;
-					uint8_t vectorDensity = 0;
+		File::BatchOperation batch = file->ReadBatch(requests, channelCount);
+		const bool success = file->WaitForBatch(batch);
+		memoryUtil::FreeArray(allocator, requests);
 
-					int64_t toRead = layerMaskDataLength;
+		if (!success)
+		{
+			PSD_ERROR("PsdExtract", "Could not read channel data of layer \"%s\".", layer->name.c_str());
+			ReleaseScratchBuffer(allocator, context, channelBuffer);
+			return false;
+		}
 
-					// enclosing rectangle
-					toRead -= ReadMaskRectangle(reader, maskData[0]);
+		return true;
+	}
 
-					maskData[0].defaultColor = fileUtil::ReadFromFileBE<uint8_t>(reader);
-					toRead -= sizeof(uint8_t);
 
-					const uint8_t maskFlags = fileUtil::ReadFromFileBE<uint8_t>(reader);
-					toRead -= sizeof(uint8_t);
+	/// A unit of work for decoding channel data, which is either a whole channel, or a band of rows of an RLE-compressed channel.
+	struct DecodeTask
+	{
+		Channel* channel;
+		const uint8_t* src;
+		uint32_t srcSize;
+		uint16_t compressionType;
+		unsigned int width;
+		unsigned int height;
+		void* dest;							///< The first row of the band, or nullptr if the whole channel is decoded.
+	};
 
-					maskData[0].isVectorMask = (maskFlags & (1u << 3)) != 0;
-					bool maskHasParameters = (maskFlags & (1u << 4)) != 0;
-					if (maskHasParameters && (layerMaskDataLength <= 28))
-					{
-						toRead -= ReadMaskParameters(reader, layerDensity, layerFeather, vectorDensity, vectorFeather);
-					}
 
-					// check if there is enough data left for another section of mask data
-					if (toRead >= 18)
-					{
-						// in case there is still data left to read, the following values are for the real layer mask.
-						// the data we just read was for the vector mask.
-						maskCount = 2u;
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int AddDecodeTasks(const Document* document, Allocator* allocator, Channel* channel, const uint8_t* src, unsigned int width, unsigned int height, unsigned int threadCount, DecodeTask* tasks)
+	{
+		const uint16_t compressionType = endianUtil::ReadBigEndian<uint16_t>(src);
+		src += sizeof(uint16_t);
+		const uint32_t srcSize = static_cast<uint32_t>(channel->size - sizeof(uint16_t));
 
-						const uint8_t realFlags = fileUtil::ReadFromFileBE<uint8_t>(reader);
-						toRead -= sizeof(uint8_t);
+		if ((compressionType != compressionType::RLE) || (threadCount <= 1u))
+		{
+			const DecodeTask task = { channel, src, srcSize, compressionType, width, height, nullptr };
+			tasks[0] = task;
+			return 1u;
+		}
 
-						maskData[1].defaultColor = fileUtil::ReadFromFileBE<uint8_t>(reader);
-						toRead -= sizeof(uint8_t);
+		// the scan line table stores the size of each compressed row, so disjoint bands of rows can be decoded independently
+		const unsigned int rowCountSize = GetRleRowCountSize(document);
+		uint32_t rleDataSize = 0u;
+		if (!GetRleDataSize(src, srcSize, height, rowCountSize, rleDataSize) || (rleDataSize == 0u))
+		{
+			return 0u;
+		}
 
-						toRead -= ReadMaskRectangle(reader, maskData[1]);
+		const unsigned int bytesPerPixel = document->bitsPerChannel / 8u;
+		uint8_t* planarData = static_cast<uint8_t*>(allocator->Allocate(static_cast<size_t>(width)*height*bytesPerPixel, 16u, allocationTag::CHANNEL_DATA));
+		channel->data = planarData;
 
-						maskData[1].isVectorMask = (realFlags & (1u << 3)) != 0;
+		unsigned int bandHeight = (height + threadCount - 1u) / threadCount;
+		if (bandHeight < MIN_RLE_BAND_HEIGHT)
+		{
+			bandHeight = MIN_RLE_BAND_HEIGHT;
+		}
 
-						// note the OR here. whether the following section has mask parameter data or not is influenced by
-						// the availability of parameter data of the previous mask!
-						maskHasParameters |= ((realFlags & (1u << 4)) != 0);
-						if (maskHasParameters)
-						{
-							toRead -= ReadMaskParameters(reader, layerDensity, layerFeather, vectorDensity, vectorFeather);
-						}
-					}
+		const uint8_t* rowTable = src;
+		const uint8_t* rleData = src + height*rowCountSize;
+		uint32_t offset = 0u;
+		unsigned int taskCount = 0u;
+		for (unsigned int y=0; y < height; y += bandHeight)
+		{
+			const unsigned int rowCount = (height - y < bandHeight) ? (height - y) : bandHeight;
 
-					// skip the remaining padding bytes, if any
-					PSD_ASSERT(toRead >= 0, "Parsing failed, %" PRId64 "bytes left.", toRead);
-					reader.Skip(static_cast<uint64_t>(toRead));
+			uint32_t bandSize = 0u;
+			for (unsigned int i=0; i < rowCount; ++i)
+			{
+				bandSize += ReadRleRowSize(rowTable, y + i, rowCountSize);
+			}
 
-					// apply mask data to our own data structures
-					for (unsigned int mask=0; mask < maskCount; ++mask)
-					{
-						const bool isVectorMask = maskData[mask].isVectorMask;
-						if (isVectorMask)
-						{
-							PSD_ASSERT(layer->vectorMask == nullptr, "A vector mask already exists.");
-							layer->vectorMask = memoryUtil::Allocate<VectorMask>(allocator);
-							layer->vectorMask->data = nullptr;
-							layer->vectorMask->fileOffset = 0ull;
-							ApplyMaskData(maskData[mask], vectorFeather, vectorDensity, layer->vectorMask);
-						}
-						else
-						{
-							PSD_ASSERT(layer->layerMask == nullptr, "A layer mask already exists.");
-							layer->layerMask = memoryUtil::Allocate<LayerMask>(allocator);
-							layer->layerMask->data = nullptr;
-							layer->layerMask->fileOffset = 0ull;
-							ApplyMaskData(maskData[mask], layerFeather, layerDensity, layer->layerMask);
-						}
-					}
-				}
+			// truncated data has already been reported, decode as much as possible
+			const uint32_t bandOffset = (offset < rleDataSize) ? offset : rleDataSize;
+			if (bandSize > rleDataSize - bandOffset)
+			{
+				bandSize = rleDataSize - bandOffset;
+			}
 
-				// skip blending ranges data, we are not interested in that for now
-				const uint32_t layerBlendingRangesDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				reader.Skip(layerBlendingRangesDataLength);
+			const DecodeTask task = { channel, rleData + bandOffset, bandSize, compressionType, width, rowCount, planarData + static_cast<size_t>(y)*width*bytesPerPixel };
+			tasks[taskCount++] = task;
+			offset += bandSize;
+		}
 
-				// the layer name is stored as pascal string, padded to a multiple of 4
-				char layerName[512] = {};
-				const uint8_t nameLength = fileUtil::ReadFromFileBE<uint8_t>(reader);
-				const uint32_t paddedNameLength = bitUtil::RoundUpToMultiple(nameLength + 1u, 4u);
-				reader.Read(layerName, paddedNameLength - 1u);
+		return taskCount;
+	}
 
-				layer->name.Assign(layerName);
 
-				// read Additional Layer Information that exists since Photoshop 4.0.
-				// getting the size of this data is a bit awkward, because it's not stored explicitly somewhere. furthermore,
-				// the PSD format sometimes includes the 4-byte length in its section size, and sometimes not.
-				const uint32_t additionalLayerInfoSize = extraDataLength - layerMaskDataLength - layerBlendingRangesDataLength - paddedNameLength - 8u;
-				int64_t toRead = additionalLayerInfoSize;
-				while (toRead > 0)
-				{
-					const uint32_t signature = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					if (signature != util::Key<'8', 'B', 'I', 'M'>::VALUE)
-					{
-						PSD_ERROR("LayerMaskSection", "Additional Layer Information section seems to be corrupt, signature does not match \"8BIM\".");
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void RunDecodeTask(const Document* document, Allocator* allocator, DecodeContext* context, const DecodeTask& task)
+	{
+		if (task.dest)
+		{
+			DecodeRowsRLE(document, task.src, task.srcSize, task.dest, task.width, task.height);
+		}
+		else
+		{
+			task.channel->data = DecodeChannelData(document, task.compressionType, task.src, task.srcSize, allocator, context, task.width, task.height);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ApplyRowPrediction(T* PSD_RESTRICT row, void* PSD_RESTRICT rowBuffer, unsigned int width)
+	{
+		static_assert(sizeof(T) == -1, "Unknown data type.");
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	void ApplyRowPrediction<uint8_t>(uint8_t* PSD_RESTRICT row, void* PSD_RESTRICT, unsigned int width)
+	{
+		imageUtil::ApplyPrediction(row, width, 1u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	void ApplyRowPrediction<uint16_t>(uint16_t* PSD_RESTRICT row, void* PSD_RESTRICT, unsigned int width)
+	{
+		imageUtil::ApplyPrediction(row, width, 1u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	void ApplyRowPrediction<float32_t>(float32_t* PSD_RESTRICT row, void* PSD_RESTRICT rowBuffer, unsigned int width)
+	{
+		imageUtil::ApplyPrediction(row, static_cast<uint8_t*>(rowBuffer), width, 1u);
+	}
+
+
+	/// Produces native-endian rows of a single channel, one row at a time, for the fused interleaving pipeline.
+	struct RowSource
+	{
+		const uint8_t* data;				///< Big-endian RAW data, or RLE data following the scan line table.
+		const uint8_t* rowTable;			///< The RLE scan line table, or nullptr.
+		unsigned int rowCountSize;			///< The size of each entry in the scan line table.
+		uint32_t dataSize;
+		uint32_t offset;					///< Offset of the next row into the data.
+		uint16_t compressionType;
+		imageUtil::InflateState* inflateState;	///< Inflates ZIP-compressed rows one at a time, or nullptr.
+		unsigned int nextRow;				///< The row that is inflated next.
+		bool hasInflateError;
+		void* predictionBuffer;				///< Backup storage for undoing the prediction of 32-bit rows, or nullptr.
+		void* rowBuffer;					///< Holds the current row, or nullptr if the channel has no data.
+		File* file;							///< The file that rows are read from in bands, or nullptr if all data is accessible.
+		uint64_t filePosition;				///< The position of the RAW or RLE data in the file.
+		uint32_t fileDataSize;				///< The size of the RAW or RLE data in the file.
+		void* rowTableBuffer;				///< Holds the RLE scan line table read from the file, or nullptr.
+		void* bandBuffer;					///< Holds the RAW or RLE data of the band of rows read from the file, or all ZIP data, or nullptr.
+		uint32_t bandBufferSize;			///< The size of the largest band of rows that is read from the file.
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadFromFile(File* file, void* buffer, uint32_t count, uint64_t position)
+	{
+		const File::ReadRequest request = { buffer, count, position };
+		File::BatchOperation batch = file->ReadBatch(&request, 1u);
+		return file->WaitForBatch(batch);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsRowSourceSizeSupported(const Channel* channel)
+	{
+		// row sources address the data of a channel using 32-bit offsets
+		if (channel->size - sizeof(uint16_t) > 0xFFFFFFFFull)
+		{
+			PSD_ERROR("PsdExtract", "Channel data of %" PRIu64 " bytes is too large to be extracted row by row.", channel->size);
+			return false;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool InitializeRowSource(const Document* document, Allocator* allocator, const Channel* channel, const uint8_t* src, unsigned int width, unsigned int height, RowSource& source)
+	{
+		source.data = nullptr;
+		source.rowTable = nullptr;
+		source.rowCountSize = GetRleRowCountSize(document);
+		source.dataSize = 0u;
+		source.offset = 0u;
+		source.compressionType = compressionType::RAW;
+		source.inflateState = nullptr;
+		source.nextRow = 0u;
+		source.hasInflateError = false;
+		source.predictionBuffer = nullptr;
+		source.rowBuffer = nullptr;
+		source.file = nullptr;
+		source.filePosition = 0ull;
+		source.fileDataSize = 0u;
+		source.rowTableBuffer = nullptr;
+		source.bandBuffer = nullptr;
+		source.bandBufferSize = 0u;
+
+		if ((channel->size < sizeof(uint16_t)) || !IsRowSourceSizeSupported(channel))
+		{
+			return false;
+		}
+
+		uint16_t compressionType = endianUtil::ReadBigEndian<uint16_t>(src);
+		src += sizeof(uint16_t);
+		const uint32_t srcSize = static_cast<uint32_t>(channel->size - sizeof(uint16_t));
+
+		// in 32-bit mode, Photoshop always interprets ZIP compression as being ZIP_WITH_PREDICTION, see DecodeChannelData
+		if ((document->bitsPerChannel == 32) && (compressionType == compressionType::ZIP))
+		{
+			compressionType = compressionType::ZIP_WITH_PREDICTION;
+		}
+		source.compressionType = compressionType;
+
+		if (compressionType == compressionType::RAW)
+		{
+			const uint64_t expectedSize = static_cast<uint64_t>(width)*height*sizeof(T);
+			if (srcSize < expectedSize)
+			{
+				PSD_ERROR("PsdExtract", "Raw channel data is too small, expected %" PRIu64 " bytes but got %u.", expectedSize, srcSize);
+				return false;
+			}
+
+			source.data = src;
+			source.dataSize = srcSize;
+		}
+		else if (compressionType == compressionType::RLE)
+		{
+			uint32_t rleDataSize = 0u;
+			if (!GetRleDataSize(src, srcSize, height, source.rowCountSize, rleDataSize) || (rleDataSize == 0u))
+			{
+				return false;
+			}
+
+			source.rowTable = src;
+			source.data = src + height*source.rowCountSize;
+			source.dataSize = rleDataSize;
+		}
+		else if ((compressionType == compressionType::ZIP) || (compressionType == compressionType::ZIP_WITH_PREDICTION))
+		{
+			if (srcSize == 0u)
+			{
+				return false;
+			}
+
+			// rows are inflated one at a time, so only the window of the zlib stream is held in memory
+			source.inflateState = imageUtil::CreateInflateState(src, srcSize, static_cast<size_t>(width)*height*sizeof(T), allocator);
+			if ((compressionType == compressionType::ZIP_WITH_PREDICTION) && (sizeof(T) == sizeof(float32_t)))
+			{
+				source.predictionBuffer = allocator->Allocate(width*sizeof(float32_t), 16u, allocationTag::DECODE_SCRATCH);
+			}
+		}
+		else
+		{
+			PSD_ASSERT(false, "Unsupported compression type %d", compressionType);
+			return false;
+		}
+
+		source.rowBuffer = allocator->Allocate(width*sizeof(T), 16u, allocationTag::DECODE_SCRATCH);
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static const T* ReadRow(RowSource& source, unsigned int y, unsigned int width)
+	{
+		const uint32_t rowSize = static_cast<uint32_t>(width*sizeof(T));
+		T* row = static_cast<T*>(source.rowBuffer);
+		if (source.inflateState)
+		{
+			// a zlib stream cannot be skipped, so rows in front of the requested one are inflated and discarded
+			for (; (source.nextRow <= y) && !source.hasInflateError; ++source.nextRow)
+			{
+				if (!imageUtil::InflateRows(source.inflateState, reinterpret_cast<uint8_t*>(row), rowSize, 1u))
+				{
+					PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
+					source.hasInflateError = true;
+				}
+			}
+
+			if (source.hasInflateError)
+			{
+				memset(row, 0, rowSize);
+			}
+			else if (source.compressionType == compressionType::ZIP_WITH_PREDICTION)
+			{
+				// the prediction only depends on the row itself, and already produces native-endian data
+				ApplyRowPrediction<T>(row, source.predictionBuffer, width);
+				return row;
+			}
+		}
+		else if (source.rowTable)
+		{
+			// truncated data has already been reported, decode as much as possible
+			uint32_t size = ReadRleRowSize(source.rowTable, y, source.rowCountSize);
+			if (size > source.dataSize - source.offset)
+			{
+				size = source.dataSize - source.offset;
+			}
+
+			imageUtil::DecompressRle(source.data + source.offset, size, reinterpret_cast<uint8_t*>(row), rowSize);
+			source.offset += size;
+		}
+		else
+		{
+			memcpy(row, source.data + source.offset, rowSize);
+			source.offset += rowSize;
+		}
+
+		// the row is still hot in the cache, so converting it here is almost free
+		EndianConvert<T>(row, width, 1u);
+
+		return row;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t GetRleRowsSize(const uint8_t* rowTable, unsigned int rowCountSize, unsigned int firstRow, unsigned int rowCount)
+	{
+		uint64_t size = 0ull;
+		for (unsigned int i=firstRow; i < firstRow + rowCount; ++i)
+		{
+			size += ReadRleRowSize(rowTable, i, rowCountSize);
+		}
+
+		return size;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool InitializeRowSource(const Document* document, File* file, Allocator* allocator, const Channel* channel, unsigned int width, unsigned int height, unsigned int firstRow, unsigned int bandHeight, RowSource& source)
+	{
+		// channels that are accessible in memory are decoded from there, skipping all rows in front of the first row
+		const uint8_t* src = static_cast<const uint8_t*>(file->GetData(channel->fileOffset, channel->size));
+		if (src)
+		{
+			if (!InitializeRowSource<T>(document, allocator, channel, src, width, height, source))
+			{
+				return false;
+			}
+
+			if (source.rowTable)
+			{
+				const uint64_t offset = GetRleRowsSize(source.rowTable, source.rowCountSize, 0u, firstRow);
+				source.offset = (offset < source.dataSize) ? static_cast<uint32_t>(offset) : source.dataSize;
+			}
+			else if (source.compressionType == compressionType::RAW)
+			{
+				source.offset = static_cast<uint32_t>(firstRow*width*sizeof(T));
+			}
+
+			return true;
+		}
+
+		// otherwise, RAW and RLE-compressed rows are read from the file in bands, see ReadRowBand
+		uint8_t compressionTypeData[sizeof(uint16_t)] = {};
+		if ((channel->size < sizeof(uint16_t)) || !IsRowSourceSizeSupported(channel) || !ReadFromFile(file, compressionTypeData, sizeof(uint16_t), channel->fileOffset))
+		{
+			return false;
+		}
+
+		const uint16_t compressionType = endianUtil::ReadBigEndian<uint16_t>(compressionTypeData);
+		const uint32_t srcSize = static_cast<uint32_t>(channel->size - sizeof(uint16_t));
+		const uint64_t srcOffset = channel->fileOffset + sizeof(uint16_t);
+		if (compressionType == compressionType::RAW)
+		{
+			const uint64_t expectedSize = static_cast<uint64_t>(width)*height*sizeof(T);
+			if (srcSize < expectedSize)
+			{
+				PSD_ERROR("PsdExtract", "Raw channel data is too small, expected %" PRIu64 " bytes but got %u.", expectedSize, srcSize);
+				return false;
+			}
+
+			source.filePosition = srcOffset;
+			source.fileDataSize = srcSize;
+			source.bandBufferSize = static_cast<uint32_t>(((bandHeight < height) ? bandHeight : height)*width*sizeof(T));
+		}
+		else if (compressionType == compressionType::RLE)
+		{
+			// keep the scan line table, it is needed for finding the RLE data of each band of rows
+			const unsigned int rowCountSize = GetRleRowCountSize(document);
+			const uint32_t rowTableSize = height*rowCountSize;
+			uint8_t* rowTable = static_cast<uint8_t*>(allocator->Allocate(rowTableSize, 16u, allocationTag::DECODE_SCRATCH));
+			uint32_t rleDataSize = 0u;
+			if (!ReadFromFile(file, rowTable, rowTableSize, srcOffset) || !GetRleDataSize(rowTable, srcSize, height, rowCountSize, rleDataSize) || (rleDataSize == 0u))
+			{
+				allocator->Free(rowTable);
+				return false;
+			}
+
+			source.rowTable = rowTable;
+			source.rowCountSize = rowCountSize;
+			source.filePosition = srcOffset + rowTableSize;
+			source.fileDataSize = rleDataSize;
+			source.rowTableBuffer = rowTable;
+
+			// bands are read starting at the first row, so the buffer must hold the largest of them
+			for (unsigned int y=firstRow; y < height; y += bandHeight)
+			{
+				const unsigned int rowCount = (height - y < bandHeight) ? (height - y) : bandHeight;
+				const uint64_t bandSize = GetRleRowsSize(rowTable, rowCountSize, y, rowCount);
+				if (bandSize >= rleDataSize)
+				{
+					source.bandBufferSize = rleDataSize;
+					break;
+				}
+				else if (bandSize > source.bandBufferSize)
+				{
+					source.bandBufferSize = static_cast<uint32_t>(bandSize);
+				}
+			}
+		}
+		else
+		{
+			// ZIP-compressed data is read as a whole, and kept around for inflating it row by row
+			uint8_t* buffer = static_cast<uint8_t*>(allocator->Allocate(static_cast<size_t>(channel->size), 16u, allocationTag::COMPRESSED_DATA));
+			if (!ReadFromFile(file, buffer, static_cast<uint32_t>(channel->size), channel->fileOffset) ||
+				!InitializeRowSource<T>(document, allocator, channel, buffer, width, height, source))
+			{
+				allocator->Free(buffer);
+				return false;
+			}
+
+			source.bandBuffer = buffer;
+			return true;
+		}
+
+		source.file = file;
+		source.rowBuffer = allocator->Allocate(width*sizeof(T), 16u, allocationTag::DECODE_SCRATCH);
+		source.bandBuffer = allocator->Allocate(source.bandBufferSize, 16u, allocationTag::COMPRESSED_DATA);
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ReadRowBand(RowSource& source, unsigned int width, unsigned int firstRow, unsigned int rowCount)
+	{
+		// only sources that read their rows from the file need to do anything
+		if (!source.file)
+		{
+			return true;
+		}
+
+		// RAW data has been checked to hold all rows, and RLE data to be smaller than 4 GB, so offsets and sizes fit into 32 bits
+		uint64_t offset = 0ull;
+		uint64_t size = 0ull;
+		if (source.rowTable)
+		{
+			// truncated data has already been reported, read as much as possible
+			offset = GetRleRowsSize(source.rowTable, source.rowCountSize, 0u, firstRow);
+			offset = (offset < source.fileDataSize) ? offset : source.fileDataSize;
+			size = GetRleRowsSize(source.rowTable, source.rowCountSize, firstRow, rowCount);
+			size = (size < source.fileDataSize - offset) ? size : source.fileDataSize - offset;
+		}
+		else
+		{
+			offset = static_cast<uint64_t>(firstRow)*width*sizeof(T);
+			size = static_cast<uint64_t>(rowCount)*width*sizeof(T);
+		}
+
+		PSD_ASSERT(size <= source.bandBufferSize, "Band of %u rows does not fit into the band buffer.", rowCount);
+		source.data = static_cast<const uint8_t*>(source.bandBuffer);
+		source.dataSize = static_cast<uint32_t>(size);
+		source.offset = 0u;
+
+		return ReadFromFile(source.file, source.bandBuffer, static_cast<uint32_t>(size), source.filePosition + offset);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyRowSource(Allocator* allocator, RowSource& source)
+	{
+		imageUtil::DestroyInflateState(source.inflateState, allocator);
+		allocator->Free(source.predictionBuffer);
+		allocator->Free(source.rowBuffer);
+		allocator->Free(source.rowTableBuffer);
+		allocator->Free(source.bandBuffer);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename TOut, typename TIn>
+	static PSD_INLINE TOut ConvertValue(TIn value)
+	{
+		static_assert(sizeof(TOut) == sizeof(TIn), "Unsupported conversion.");
+		return value;
+	}
+
+	template <>
+	PSD_INLINE uint8_t ConvertValue<uint8_t, uint16_t>(uint16_t value)
+	{
+		// scale from 0..65535 to 0..255 with correct rounding
+		return static_cast<uint8_t>((value*255u + 32767u) / 65535u);
+	}
+
+	template <>
+	PSD_INLINE uint8_t ConvertValue<uint8_t, float32_t>(float32_t value)
+	{
+		const float32_t clamped = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+		return static_cast<uint8_t>(clamped*255.0f + 0.5f);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T GetOpaqueValue(void)
+	{
+		return static_cast<T>(~T(0));
+	}
+
+	template <>
+	float32_t GetOpaqueValue<float32_t>(void)
+	{
+		return 1.0f;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename TOut, typename TIn>
+	static void InterleaveRow(const TIn* PSD_RESTRICT r, const TIn* PSD_RESTRICT g, const TIn* PSD_RESTRICT b, const TIn* PSD_RESTRICT a, TOut* PSD_RESTRICT dest, unsigned int width)
+	{
+		if (a)
+		{
+			for (unsigned int x=0; x < width; ++x)
+			{
+				dest[0] = ConvertValue<TOut>(r[x]);
+				dest[1] = ConvertValue<TOut>(g[x]);
+				dest[2] = ConvertValue<TOut>(b[x]);
+				dest[3] = ConvertValue<TOut>(a[x]);
+				dest += 4;
+			}
+		}
+		else
+		{
+			const TOut alpha = GetOpaqueValue<TOut>();
+			for (unsigned int x=0; x < width; ++x)
+			{
+				dest[0] = ConvertValue<TOut>(r[x]);
+				dest[1] = ConvertValue<TOut>(g[x]);
+				dest[2] = ConvertValue<TOut>(b[x]);
+				dest[3] = alpha;
+				dest += 4;
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename TOut, typename TIn>
+	static void* ExtractLayerInterleaved(const Document* document, Allocator* allocator, const Layer* layer, const uint8_t** channelSources, const int* channelIndices)
+	{
+		const unsigned int width = static_cast<unsigned int>(layer->right - layer->left);
+		const unsigned int height = static_cast<unsigned int>(layer->bottom - layer->top);
+
+		// the R, G, B and transparency channels all share the layer's extents.
+		// channels that are not stored or hold no data are treated as being black, a missing transparency mask as opaque.
+		RowSource sources[4] = {};
+		bool hasData[4] = {};
+		TIn* zeroRow = static_cast<TIn*>(allocator->Allocate(width*sizeof(TIn), 16u, allocationTag::DECODE_SCRATCH));
+		memset(zeroRow, 0, width*sizeof(TIn));
+		for (unsigned int i=0; i < 4u; ++i)
+		{
+			if (channelIndices[i] >= 0)
+			{
+				const Channel* channel = &layer->channels[channelIndices[i]];
+				hasData[i] = InitializeRowSource<TIn>(document, allocator, channel, channelSources[channelIndices[i]], width, height, sources[i]);
+			}
+		}
+
+		// decode one row of each channel and interleave it right away, while the rows are still in the cache
+		TOut* image = static_cast<TOut*>(allocator->Allocate(static_cast<size_t>(width)*height*4u*sizeof(TOut), 16u, allocationTag::INTERLEAVED_IMAGE));
+		TOut* dest = image;
+		for (unsigned int y=0; y < height; ++y, dest += width*4u)
+		{
+			const TIn* rows[4] = {};
+			for (unsigned int i=0; i < 4u; ++i)
+			{
+				rows[i] = hasData[i] ? ReadRow<TIn>(sources[i], y, width) : zeroRow;
+			}
+
+			const TIn* alpha = (channelIndices[3] >= 0) ? rows[3] : nullptr;
+			InterleaveRow<TOut>(rows[0], rows[1], rows[2], alpha, dest, width);
+		}
+
+		for (unsigned int i=0; i < 4u; ++i)
+		{
+			DestroyRowSource(allocator, sources[i]);
+		}
+		allocator->Free(zeroRow);
+
+		return image;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename TOut, typename TIn>
+	static void* ExtractLayerRegion(const Document* document, File* file, Allocator* allocator, const Layer* layer, const int* channelIndices, int left, int top, int right, int bottom)
+	{
+		const unsigned int width = static_cast<unsigned int>(right - left);
+		const unsigned int height = static_cast<unsigned int>(bottom - top);
+
+		// pixels of the region that are not covered by the layer are fully transparent
+		const size_t imageSize = static_cast<size_t>(width)*height*4u*sizeof(TOut);
+		TOut* image = static_cast<TOut*>(allocator->Allocate(imageSize, 16u, allocationTag::INTERLEAVED_IMAGE));
+		memset(image, 0, imageSize);
+
+		const int regionLeft = (left > layer->left) ? left : layer->left;
+		const int regionTop = (top > layer->top) ? top : layer->top;
+		const int regionRight = (right < layer->right) ? right : layer->right;
+		const int regionBottom = (bottom < layer->bottom) ? bottom : layer->bottom;
+		if ((regionRight <= regionLeft) || (regionBottom <= regionTop) || (channelIndices[0] < 0))
+		{
+			return image;
+		}
+
+		// only the rows intersecting the region are read and decoded, and only the columns inside the region are interleaved
+		const unsigned int layerWidth = static_cast<unsigned int>(layer->right - layer->left);
+		const unsigned int layerHeight = static_cast<unsigned int>(layer->bottom - layer->top);
+		const unsigned int firstRow = static_cast<unsigned int>(regionTop - layer->top);
+		const unsigned int rowCount = static_cast<unsigned int>(regionBottom - regionTop);
+		const unsigned int firstColumn = static_cast<unsigned int>(regionLeft - layer->left);
+		const unsigned int columnCount = static_cast<unsigned int>(regionRight - regionLeft);
+
+		RowSource sources[4] = {};
+		bool hasData[4] = {};
+		TIn* zeroRow = static_cast<TIn*>(allocator->Allocate(layerWidth*sizeof(TIn), 16u, allocationTag::DECODE_SCRATCH));
+		memset(zeroRow, 0, layerWidth*sizeof(TIn));
+		for (unsigned int i=0; i < 4u; ++i)
+		{
+			if (channelIndices[i] >= 0)
+			{
+				const Channel* channel = &layer->channels[channelIndices[i]];
+				hasData[i] = InitializeRowSource<TIn>(document, file, allocator, channel, layerWidth, layerHeight, firstRow, rowCount, sources[i]) &&
+					ReadRowBand<TIn>(sources[i], layerWidth, firstRow, rowCount);
+			}
+		}
+
+		TOut* dest = image + (static_cast<size_t>(regionTop - top)*width + static_cast<size_t>(regionLeft - left))*4u;
+		for (unsigned int y=firstRow; y < firstRow + rowCount; ++y, dest += width*4u)
+		{
+			const TIn* rows[4] = {};
+			for (unsigned int i=0; i < 4u; ++i)
+			{
+				rows[i] = (hasData[i] ? ReadRow<TIn>(sources[i], y, layerWidth) : zeroRow) + firstColumn;
+			}
+
+			const TIn* alpha = (channelIndices[3] >= 0) ? rows[3] : nullptr;
+			InterleaveRow<TOut>(rows[0], rows[1], rows[2], alpha, dest, columnCount);
+		}
+
+		for (unsigned int i=0; i < 4u; ++i)
+		{
+			DestroyRowSource(allocator, sources[i]);
+		}
+		allocator->Free(zeroRow);
+
+		return image;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ExtractLayerRows(const Document* document, File* file, Allocator* allocator, const Layer* layer, const int* channelIndices, unsigned int channelCount, RowSink* sink)
+	{
+		const unsigned int width = static_cast<unsigned int>(layer->right - layer->left);
+		const unsigned int height = static_cast<unsigned int>(layer->bottom - layer->top);
+
+		RowSource* sources = memoryUtil::AllocateArray<RowSource>(allocator, channelCount, allocationTag::DECODE_SCRATCH);
+		bool* hasData = memoryUtil::AllocateArray<bool>(allocator, channelCount, allocationTag::DECODE_SCRATCH);
+		const void** rows = memoryUtil::AllocateArray<const void*>(allocator, channelCount, allocationTag::DECODE_SCRATCH);
+		memset(sources, 0, channelCount*sizeof(RowSource));
+
+		T* zeroRow = static_cast<T*>(allocator->Allocate(width*sizeof(T), 16u, allocationTag::DECODE_SCRATCH));
+		memset(zeroRow, 0, width*sizeof(T));
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			const Channel* channel = &layer->channels[channelIndices[i]];
+			hasData[i] = InitializeRowSource<T>(document, file, allocator, channel, width, height, 0u, STREAM_BAND_HEIGHT, sources[i]);
+		}
+
+		// at most one band of compressed rows per channel is held in memory at any time
+		bool success = true;
+		for (unsigned int y=0; (y < height) && success; y += STREAM_BAND_HEIGHT)
+		{
+			const unsigned int rowCount = (height - y < STREAM_BAND_HEIGHT) ? (height - y) : STREAM_BAND_HEIGHT;
+			for (unsigned int i=0; i < channelCount; ++i)
+			{
+				if (hasData[i] && !ReadRowBand<T>(sources[i], width, y, rowCount))
+				{
+					PSD_ERROR("PsdExtract", "Could not read channel data of layer \"%s\".", layer->name.c_str());
+					success = false;
+				}
+			}
+
+			for (unsigned int row=y; (row < y + rowCount) && success; ++row)
+			{
+				for (unsigned int i=0; i < channelCount; ++i)
+				{
+					rows[i] = hasData[i] ? ReadRow<T>(sources[i], row, width) : zeroRow;
+				}
+
+				success = sink->ProcessRow(row, rows, width);
+			}
+		}
+
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			DestroyRowSource(allocator, sources[i]);
+		}
+		allocator->Free(zeroRow);
+		memoryUtil::FreeArray(allocator, rows);
+		memoryUtil::FreeArray(allocator, hasData);
+		memoryUtil::FreeArray(allocator, sources);
+
+		return success;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool FindColorChannels(const Layer* layer, int* channelIndices)
+	{
+		// find the R, G, B and transparency channels. there is no guarantee that R is the first channel, G the second, and so on.
+		channelIndices[0] = channelIndices[1] = channelIndices[2] = channelIndices[3] = -1;
+		for (unsigned int i=0; i < layer->channelCount; ++i)
+		{
+			const int16_t type = layer->channels[i].type;
+			if ((type >= channelType::R) && (type <= channelType::B))
+			{
+				channelIndices[type] = static_cast<int>(i);
+			}
+			else if (type == channelType::TRANSPARENCY_MASK)
+			{
+				channelIndices[3] = static_cast<int>(i);
+			}
+		}
+
+		if ((channelIndices[0] < 0) || (channelIndices[1] < 0) || (channelIndices[2] < 0))
+		{
+			PSD_ERROR("PsdExtract", "Layer \"%s\" does not store R, G and B channels.", layer->name.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t ReadLayerInfoLength(SyncFileReader& reader, const Document* document)
+	{
+		// .PSB files store the length of the Layer Info section in 8 bytes
+		return (document->version == 2u)
+			? fileUtil::ReadFromFileBE<uint64_t>(reader)
+			: fileUtil::ReadFromFileBE<uint32_t>(reader);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsAdditionalLayerInfoSignature(uint32_t signature)
+	{
+		// .PSB files may store Additional Layer Information using the signature '8B64' instead of '8BIM'
+		return (signature == util::Key<'8', 'B', 'I', 'M'>::VALUE) || (signature == util::Key<'8', 'B', '6', '4'>::VALUE);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int ReadAdditionalLayerInfoLength(SyncFileReader& reader, const Document* document, uint32_t key, uint64_t& length)
+	{
+		// .PSB files store the length of the keys that can hold large amounts of data in 8 bytes.
+		// returns the number of bytes the length was stored in.
+		if (document->version == 2u)
+		{
+			switch (key)
+			{
+				case util::Key<'L', 'M', 's', 'k'>::VALUE:
+				case util::Key<'L', 'r', '1', '6'>::VALUE:
+				case util::Key<'L', 'r', '3', '2'>::VALUE:
+				case util::Key<'L', 'a', 'y', 'r'>::VALUE:
+				case util::Key<'M', 't', '1', '6'>::VALUE:
+				case util::Key<'M', 't', '3', '2'>::VALUE:
+				case util::Key<'M', 't', 'r', 'n'>::VALUE:
+				case util::Key<'A', 'l', 'p', 'h'>::VALUE:
+				case util::Key<'F', 'M', 's', 'k'>::VALUE:
+				case util::Key<'l', 'n', 'k', '2'>::VALUE:
+				case util::Key<'F', 'E', 'i', 'd'>::VALUE:
+				case util::Key<'F', 'X', 'i', 'd'>::VALUE:
+				case util::Key<'P', 'x', 'S', 'D'>::VALUE:
+					length = fileUtil::ReadFromFileBE<uint64_t>(reader);
+					return sizeof(uint64_t);
+
+				default:
+					break;
+			}
+		}
+
+		length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		return sizeof(uint32_t);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadAdditionalLayerInfo(const Document* document, SyncFileReader& reader, Allocator* allocator, Layer* layer, uint32_t extraDataLength, uint32_t layerMaskDataLength, bool readLayerTypeOnly)
+	{
+		// reads the part of a layer record that follows the layer mask data. if only the layer type is needed, the layer
+		// name is skipped, and reading stops at the section divider setting.
+
+		// skip blending ranges data, we are not interested in that for now
+		const uint32_t layerBlendingRangesDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		reader.Skip(layerBlendingRangesDataLength);
+
+		// the layer name is stored as pascal string, padded to a multiple of 4
+		const uint8_t nameLength = fileUtil::ReadFromFileBE<uint8_t>(reader);
+		const uint32_t paddedNameLength = bitUtil::RoundUpToMultiple(nameLength + 1u, 4u);
+		if (readLayerTypeOnly)
+		{
+			reader.Skip(paddedNameLength - 1u);
+		}
+		else
+		{
+			char layerName[512] = {};
+			reader.Read(layerName, paddedNameLength - 1u);
+
+			layer->name.Assign(layerName);
+		}
+
+		// read Additional Layer Information that exists since Photoshop 4.0.
+		// getting the size of this data is a bit awkward, because it's not stored explicitly somewhere. furthermore,
+		// the PSD format sometimes includes the 4-byte length in its section size, and sometimes not.
+		const uint32_t additionalLayerInfoSize = extraDataLength - layerMaskDataLength - layerBlendingRangesDataLength - paddedNameLength - 8u;
+		int64_t toRead = additionalLayerInfoSize;
+		while (toRead > 0)
+		{
+			const uint32_t signature = fileUtil::ReadFromFileBE<uint32_t>(reader);
+			if (!IsAdditionalLayerInfoSignature(signature))
+			{
+				PSD_ERROR("LayerMaskSection", "Additional Layer Information section seems to be corrupt, signature does not match \"8BIM\" or \"8B64\".");
+				return false;
+			}
+
+			const uint32_t key = fileUtil::ReadFromFileBE<uint32_t>(reader);
+
+			// length needs to be rounded to an even number
+			uint64_t length = 0ull;
+			const unsigned int lengthSize = ReadAdditionalLayerInfoLength(reader, document, key, length);
+			length = bitUtil::RoundUpToMultiple<uint64_t>(length, 2u);
+
+			// read "Section divider setting" to identify whether a layer is a group, or a section divider
+			if (key == util::Key<'l', 's', 'c', 't'>::VALUE)
+			{
+				layer->type = fileUtil::ReadFromFileBE<uint32_t>(reader);
+
+				// there may be another blend mode here to tell us if the group is pass-through
+				if (length >= 12u)
+				{
+					const uint32_t lsctKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
+					const uint32_t modeKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
+					layer->isPassThrough = (lsctKey == util::Key<'8', 'B', 'I', 'M'>::VALUE && modeKey == util::Key<'p', 'a', 's', 's'>::VALUE);
+					reader.Skip(length - 12u);
+				}
+				else
+				{
+					// skip the rest of the data
+					reader.Skip(length - 4u);
+				}
+
+				// the section divider setting is the only thing needed for the layer type
+				if (readLayerTypeOnly)
+				{
+					return true;
+				}
+			}
+			// read Unicode layer name
+			else if ((key == util::Key<'l', 'u', 'n', 'i'>::VALUE) && !readLayerTypeOnly)
+			{
+				// PSD Unicode strings store 4 bytes for the number of characters, NOT bytes, followed by
+				// 2-byte UTF16 Unicode data without the terminating null.
+				const uint32_t characterCountWithoutNull = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				layer->utf16Name = memoryUtil::AllocateArray<uint16_t>(allocator, characterCountWithoutNull + 1u, allocationTag::LAYER_RECORDS);
+
+				for (uint32_t c = 0u; c < characterCountWithoutNull; ++c)
+				{
+					layer->utf16Name[c] = fileUtil::ReadFromFileBE<uint16_t>(reader);
+				}
+				layer->utf16Name[characterCountWithoutNull] = 0u;
+
+				// skip possible padding bytes
+				reader.Skip(length - 4u - characterCountWithoutNull * sizeof(uint16_t));
+			}
+			else
+			{
+				reader.Skip(length);
+			}
+
+			toRead -= 2*sizeof(uint32_t) + lengthSize + length;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadLayerExtraData(const Document* document, SyncFileReader& reader, Allocator* allocator, Layer* layer, uint32_t extraDataLength)
+	{
+		const uint32_t layerMaskDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+
+		// the layer mask data section is weird. it may contain extra data for masks, such as density and feather parameters.
+		// there are 3 main possibilities:
+		//	*) length == zero		->	skip this section
+		//	*) length == [20, 28]	->	there is one mask, and that could be either a layer or vector mask.
+		//								the mask flags give rise to mask parameters. they store the mask type, and additional parameters, if any.
+		//								there might be some padding at the end of this section, and its size depends on which parameters are there.
+		//	*) length == [36, 56]	->	there are two masks. the first mask has parameters, but does NOT store flags yet.
+		//								instead, there comes a second section with the same info (flags, default color, rectangle), and
+		//								the parameters follow after that. there is also padding at the end of this second section.
+		if (layerMaskDataLength != 0)
+		{
+			// there can be at most two masks, one layer and one vector mask
+			MaskData maskData[2] = {};
+			unsigned int maskCount = 1u;
+
+			float64_t layerFeather = 0.0;
+			float64_t vectorFeather = 0.0;
+			uint8_t layerDensity = 0;
+			uint8_t vectorDensity = 0;
+
+			int64_t toRead = layerMaskDataLength;
+
+			// enclosing rectangle
+			toRead -= ReadMaskRectangle(reader, maskData[0]);
+
+			maskData[0].defaultColor = fileUtil::ReadFromFileBE<uint8_t>(reader);
+			toRead -= sizeof(uint8_t);
+
+			const uint8_t maskFlags = fileUtil::ReadFromFileBE<uint8_t>(reader);
+			toRead -= sizeof(uint8_t);
+
+			maskData[0].isVectorMask = (maskFlags & (1u << 3)) != 0;
+			bool maskHasParameters = (maskFlags & (1u << 4)) != 0;
+			if (maskHasParameters && (layerMaskDataLength <= 28))
+			{
+				toRead -= ReadMaskParameters(reader, layerDensity, layerFeather, vectorDensity, vectorFeather);
+			}
+
+			// check if there is enough data left for another section of mask data
+			if (toRead >= 18)
+			{
+				// in case there is still data left to read, the following values are for the real layer mask.
+				// the data we just read was for the vector mask.
+				maskCount = 2u;
+
+				const uint8_t realFlags = fileUtil::ReadFromFileBE<uint8_t>(reader);
+				toRead -= sizeof(uint8_t);
+
+				maskData[1].defaultColor = fileUtil::ReadFromFileBE<uint8_t>(reader);
+				toRead -= sizeof(uint8_t);
+
+				toRead -= ReadMaskRectangle(reader, maskData[1]);
+
+				maskData[1].isVectorMask = (realFlags & (1u << 3)) != 0;
+
+				// note the OR here. whether the following section has mask parameter data or not is influenced by
+				// the availability of parameter data of the previous mask!
+				maskHasParameters |= ((realFlags & (1u << 4)) != 0);
+				if (maskHasParameters)
+				{
+					toRead -= ReadMaskParameters(reader, layerDensity, layerFeather, vectorDensity, vectorFeather);
+				}
+			}
+
+			// skip the remaining padding bytes, if any
+			PSD_ASSERT(toRead >= 0, "Parsing failed, %" PRId64 "bytes left.", toRead);
+			reader.Skip(static_cast<uint64_t>(toRead));
+
+			// apply mask data to our own data structures
+			for (unsigned int mask=0; mask < maskCount; ++mask)
+			{
+				const bool isVectorMask = maskData[mask].isVectorMask;
+				if (isVectorMask)
+				{
+					PSD_ASSERT(layer->vectorMask == nullptr, "A vector mask already exists.");
+					layer->vectorMask = memoryUtil::Allocate<VectorMask>(allocator);
+					layer->vectorMask->data = nullptr;
+					layer->vectorMask->fileOffset = 0ull;
+					ApplyMaskData(maskData[mask], vectorFeather, vectorDensity, layer->vectorMask);
+				}
+				else
+				{
+					PSD_ASSERT(layer->layerMask == nullptr, "A layer mask already exists.");
+					layer->layerMask = memoryUtil::Allocate<LayerMask>(allocator);
+					layer->layerMask->data = nullptr;
+					layer->layerMask->fileOffset = 0ull;
+					ApplyMaskData(maskData[mask], layerFeather, layerDensity, layer->layerMask);
+				}
+			}
+		}
+
+		if (!ReadAdditionalLayerInfo(document, reader, allocator, layer, extraDataLength, layerMaskDataLength, false))
+		{
+			return false;
+		}
+
+		layer->isRecordParsed = true;
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadLayerType(const Document* document, SyncFileReader& reader, Layer* layer, uint32_t extraDataLength)
+	{
+		// skip everything up to the Additional Layer Information, which stores whether a layer is a group
+		const uint32_t layerMaskDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		reader.Skip(layerMaskDataLength);
+
+		return ReadAdditionalLayerInfo(document, reader, nullptr, layer, extraDataLength, layerMaskDataLength, true);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static LayerMaskSection* ParseLayer(const Document* document, SyncFileReader& reader, Allocator* allocator, uint64_t sectionOffset, uint64_t sectionLength, uint64_t layerLength, bool parseRecords)
+	{
+		LayerMaskSection* layerMaskSection = memoryUtil::Allocate<LayerMaskSection>(allocator);
+		layerMaskSection->layers = nullptr;
+		layerMaskSection->layerCount = 0u;
+		layerMaskSection->overlayColorSpace = 0u;
+		layerMaskSection->opacity = 0u;
+		layerMaskSection->kind = 128u;
+		layerMaskSection->hasTransparencyMask = false;
+
+		if (layerLength != 0)
+		{
+			// read the layer count. if it is a negative number, its absolute value is the number of layers and the 
+			// first alpha channel contains the transparency data for the merged result.
+			// this will also be reflected in the channelCount of the document.
+			int16_t layerCount = fileUtil::ReadFromFileBE<int16_t>(reader);
+			layerMaskSection->hasTransparencyMask = (layerCount < 0);
+			if (layerCount < 0)
+				layerCount = -layerCount;
+
+			layerMaskSection->layerCount = static_cast<unsigned int>(layerCount);
+			layerMaskSection->layers = memoryUtil::AllocateArray<Layer>(allocator, layerMaskSection->layerCount, allocationTag::LAYER_RECORDS);
+
+			// read layer record for each layer
+			for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+			{
+				Layer* layer = &layerMaskSection->layers[i];
+				layer->parent = nullptr;
+				layer->utf16Name = nullptr;
+				layer->layerMask = nullptr;
+				layer->vectorMask = nullptr;
+				layer->type = layerType::ANY;
+				layer->isPassThrough = false;
+				layer->isRecordParsed = false;
+				layer->name.Clear();
+
+				layer->top = fileUtil::ReadFromFileBE<int32_t>(reader);
+				layer->left = fileUtil::ReadFromFileBE<int32_t>(reader);
+				layer->bottom = fileUtil::ReadFromFileBE<int32_t>(reader);
+				layer->right = fileUtil::ReadFromFileBE<int32_t>(reader);
+
+				// number of channels in the layer.
+				// this includes channels for transparency, layer, and vector masks, if any.
+				const uint16_t channelCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
+				layer->channelCount = channelCount;
+				layer->channels = memoryUtil::AllocateArray<Channel>(allocator, channelCount, allocationTag::LAYER_RECORDS);
+
+				// parse each channel
+				for (unsigned int j=0; j < channelCount; ++j)
+				{
+					Channel* channel = &layer->channels[j];
+					channel->fileOffset = 0ull;
+					channel->data = nullptr;
+					channel->isDataBorrowed = false;
+					channel->type = fileUtil::ReadFromFileBE<int16_t>(reader);
+
+					// .PSB files store the length of the channel data in 8 bytes
+					channel->size = (document->version == 2u)
+						? fileUtil::ReadFromFileBE<uint64_t>(reader)
+						: fileUtil::ReadFromFileBE<uint32_t>(reader);
+				}
+
+				// blend mode signature must be '8BIM'
+				const uint32_t blendModeSignature = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				if (blendModeSignature != util::Key<'8', 'B', 'I', 'M'>::VALUE)
+				{
+					PSD_ERROR("LayerMaskSection", "Layer mask info section seems to be corrupt, signature does not match \"8BIM\".");
+
+					// the layers following this one have not been initialized yet
+					layerMaskSection->layerCount = i + 1u;
+					return layerMaskSection;
+				}
+
+				layer->blendModeKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				layer->opacity = fileUtil::ReadFromFileBE<uint8_t>(reader);
+				layer->clipping = fileUtil::ReadFromFileBE<uint8_t>(reader);
+
+				// extract flag information into layer struct
+				{
+					const uint8_t flags = fileUtil::ReadFromFileBE<uint8_t>(reader);
+					layer->isVisible = !((flags & (1u << 1)) != 0);
+				}
+
+				// skip filler byte
+				{
+					const uint8_t filler = fileUtil::ReadFromFileBE<uint8_t>(reader);
+					PSD_UNUSED(filler);
+				}
+
+				const uint32_t extraDataLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+
+				// remember where the extra data is stored, so it can be parsed later in case we only build an index
+				layer->recordOffset = reader.GetPosition();
+				layer->recordLength = extraDataLength;
+
+				const bool success = parseRecords
+					? ReadLayerExtraData(document, reader, allocator, layer, extraDataLength)
+					: ReadLayerType(document, reader, layer, extraDataLength);
+				if (!success)
+				{
+					layerMaskSection->layerCount = i + 1u;
+					return layerMaskSection;
+				}
+
+				reader.SetPosition(layer->recordOffset + extraDataLength);
+			}
+
+			// walk through the layers and channels, but don't extract their data just yet. only save the file offset for extracting the
+			// data later.
+			for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+			{
+				Layer* layer = &layerMaskSection->layers[i];
+				const unsigned int channelCount = layer->channelCount;
+				for (unsigned int j=0; j < channelCount; ++j)
+				{
+					Channel* channel = &layer->channels[j];
+					channel->fileOffset = reader.GetPosition();
+					reader.Skip(channel->size);
+
+					// channel data is read and decoded in one piece, which limits its size to 4 GB. larger channels are treated
+					// like channels without data, so that all other channels and layers can still be extracted.
+					if (channel->size > 0xFFFFFFFFull)
+					{
+						PSD_ERROR("LayerMaskSection", "Channel data of %" PRIu64 " bytes of layer \"%s\" is too large to be extracted.", channel->size, layer->name.c_str());
+						channel->size = 0ull;
+					}
+				}
+			}
+		}
+
+		if (sectionLength > 0)
+		{
+			// start loading at the global layer mask info section, located after the Layer Information Section.
+			// note that the 4 bytes (8 bytes in .PSB files) that stored the length of the section are not included in the length itself.
+			const uint64_t layerLengthSize = (document->version == 2u) ? sizeof(uint64_t) : sizeof(uint32_t);
+			const uint64_t globalInfoSectionOffset = sectionOffset + layerLength + layerLengthSize;
+			reader.SetPosition(globalInfoSectionOffset);
+
+			// work out how many bytes are left to read at this point. we need that to figure out the size of the last
+			// optional section, the Additional Layer Information.
+			if (sectionOffset + sectionLength > globalInfoSectionOffset)
+			{
+				int64_t toRead = static_cast<int64_t>(sectionOffset + sectionLength - globalInfoSectionOffset);
+				const uint32_t globalLayerMaskLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				toRead -= sizeof(uint32_t);
+
+				if (globalLayerMaskLength != 0)
+				{
+					layerMaskSection->overlayColorSpace = fileUtil::ReadFromFileBE<uint16_t>(reader);
+
+					// 4*2 byte color components
+					reader.Skip(8);
+
+					layerMaskSection->opacity = fileUtil::ReadFromFileBE<uint16_t>(reader);
+					layerMaskSection->kind = fileUtil::ReadFromFileBE<uint8_t>(reader);
+
+					toRead -= 2u*sizeof(uint16_t) + sizeof(uint8_t) + 8u;
+
+					// filler bytes (zeroes)
+					const uint32_t remaining = globalLayerMaskLength - 2u*sizeof(uint16_t) - sizeof(uint8_t) - 8u;
+					reader.Skip(remaining);
+
+					toRead -= remaining;
+				}
+
+				// are there still bytes left to read? then this is the Additional Layer Information that exists since Photoshop 4.0.
+				while (toRead > 0)
+				{
+					const uint32_t signature = fileUtil::ReadFromFileBE<uint32_t>(reader);
+					if (!IsAdditionalLayerInfoSignature(signature))
+					{
+						PSD_ERROR("AdditionalLayerInfo", "Additional Layer Information section seems to be corrupt, signature does not match \"8BIM\" or \"8B64\".");
 						return layerMaskSection;
 					}
 
 					const uint32_t key = fileUtil::ReadFromFileBE<uint32_t>(reader);
 
-					// length needs to be rounded to an even number
-					uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					length = bitUtil::RoundUpToMultiple(length, 2u);
+					// again, length is rounded to a multiple of 4
+					uint64_t length = 0ull;
+					const unsigned int lengthSize = ReadAdditionalLayerInfoLength(reader, document, key, length);
+					length = bitUtil::RoundUpToMultiple<uint64_t>(length, 4u);
 
-					// read "Section divider setting" to identify whether a layer is a group, or a section divider
-					if (key == util::Key<'l', 's', 'c', 't'>::VALUE)
+					if (key == util::Key<'L', 'r', '1', '6'>::VALUE)
 					{
-						layer->type = fileUtil::ReadFromFileBE<uint32_t>(reader);
-
-						// there may be another blend mode here to tell us if the group is pass-through
-						if(length >= 12u)
-						{
-							const uint32_t lsctKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
-							const uint32_t modeKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
-							if (lsctKey == util::Key<'8', 'B', 'I', 'M'>::VALUE && modeKey == util::Key<'p', 'a', 's', 's'>::VALUE)
-							{
-								layer->isPassThrough = true;
-							}
-							reader.Skip(length - 12u);
-						}
-						else
-						{
-							// skip the rest of the data
-							reader.Skip(length - 4u);
-						}
+						const uint64_t offset = reader.GetPosition();
+						DestroyLayerMaskSection(layerMaskSection, allocator);
+						layerMaskSection = ParseLayer(document, reader, allocator, 0u, 0u, length, parseRecords);
+						reader.SetPosition(offset + length);
+					}
+					else if (key == util::Key<'L', 'r', '3', '2'>::VALUE)
+					{
+						const uint64_t offset = reader.GetPosition();
+						DestroyLayerMaskSection(layerMaskSection, allocator);
+						layerMaskSection = ParseLayer(document, reader, allocator, 0u, 0u, length, parseRecords);
+						reader.SetPosition(offset + length);
+					}
+					else if (key == util::Key<'v', 'm', 's', 'k'>::VALUE)
+					{
+						// TODO: could read extra vector mask data here
+						reader.Skip(length);
 					}
-					// read Unicode layer name
-					else if (key == util::Key<'l', 'u', 'n', 'i'>::VALUE)
+					else if (key == util::Key<'l', 'n', 'k', '2'>::VALUE)
 					{
-						// PSD Unicode strings store 4 bytes for the number of characters, NOT bytes, followed by
-						// 2-byte UTF16 Unicode data without the terminating null.
-						const uint32_t characterCountWithoutNull = fileUtil::ReadFromFileBE<uint32_t>(reader);
-						layer->utf16Name = memoryUtil::AllocateArray<uint16_t>(allocator, characterCountWithoutNull + 1u);
-
-						for (uint32_t c = 0u; c < characterCountWithoutNull; ++c)
-						{
-							layer->utf16Name[c] = fileUtil::ReadFromFileBE<uint16_t>(reader);
-						}
-						layer->utf16Name[characterCountWithoutNull] = 0u;
-
-						// skip possible padding bytes
-						reader.Skip(length - 4u - characterCountWithoutNull * sizeof(uint16_t));
+						// TODO: could read individual smart object layer data here
+						reader.Skip(length);
 					}
 					else
 					{
 						reader.Skip(length);
 					}
 
-					toRead -= 3*sizeof(uint32_t) + length;
-				}
-			}
+					toRead -= 2u*sizeof(uint32_t) + lengthSize + length;
+				}
+			}
+		}
+
+		return layerMaskSection;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Allocator* allocator, bool parseRecords)
+	{
+		PSD_ASSERT_NOT_NULL(file);
+		PSD_ASSERT_NOT_NULL(allocator);
+
+		// if there are no layers or masks, this section is just 4 bytes: the length field, which is set to zero.
+		const Section& section = document->layerMaskInfoSection;
+		if (section.length == 0)
+		{
+			PSD_ERROR("PSD", "Document does not contain a layer mask section.");
+			return nullptr;
+		}
+
+		SyncFileReader reader(file, allocator);
+		reader.SetPosition(section.offset);
+
+		const uint64_t layerInfoSectionLength = ReadLayerInfoLength(reader, document);
+		LayerMaskSection* layerMaskSection = ParseLayer(document, reader, allocator, section.offset, section.length, layerInfoSectionLength, parseRecords);
+
+		// build the layer hierarchy
+		if (layerMaskSection && layerMaskSection->layers)
+		{
+			Layer* layerStack[256] = {};
+			layerStack[0] = nullptr;
+			int stackIndex = 0;
+
+			for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+			{
+				// note that it is much easier to build the hierarchy by traversing the layers backwards
+				Layer* layer = &layerMaskSection->layers[layerMaskSection->layerCount - i - 1u];
+
+				PSD_ASSERT(stackIndex >= 0 && stackIndex < 256, "Stack index is out of bounds.");
+				layer->parent = layerStack[stackIndex];
+
+				unsigned int width = 0u;
+				unsigned int height = 0u;
+				GetExtents(layer, width, height);
+
+				const bool isGroupStart = (layer->type == layerType::OPEN_FOLDER) || (layer->type == layerType::CLOSED_FOLDER);
+				const bool isGroupEnd = (layer->type == layerType::SECTION_DIVIDER);
+				if (isGroupEnd)
+				{
+					--stackIndex;
+				}
+				else if (isGroupStart)
+				{
+					++stackIndex;
+					layerStack[stackIndex] = layer;
+				}
+			}
+		}
+
+		return layerMaskSection;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ExtractLayerData(const Document* document, File* file, Allocator* allocator, Layer* layer, unsigned int threadCount, DecodeContext* context, bool borrowRawData)
+	{
+		PSD_ASSERT_NOT_NULL(file);
+		PSD_ASSERT_NOT_NULL(allocator);
+		PSD_ASSERT_NOT_NULL(layer);
+
+		// masks are part of the layer record, and are needed to determine the extents of mask channels
+		ParseLayerRecord(document, file, allocator, layer);
+
+		if (threadCount == 0u)
+		{
+			threadCount = threadUtil::GetHardwareThreadCount();
+		}
+
+		const unsigned int channelCount = layer->channelCount;
+
+		// the decode tasks and the channel sources share one scratch buffer. tasks come first, because their alignment is at least
+		// that of a pointer.
+		const unsigned int maxBandCount = (threadCount > 1u) ? threadCount : 1u;
+		const size_t tasksSize = channelCount*maxBandCount*sizeof(DecodeTask);
+		void* taskBuffer = GetScratchBuffer(allocator, context, decodeBuffer::CHANNEL_TASKS, tasksSize + channelCount*sizeof(const uint8_t*));
+		DecodeTask* tasks = static_cast<DecodeTask*>(taskBuffer);
+		const uint8_t** channelSources = reinterpret_cast<const uint8_t**>(static_cast<uint8_t*>(taskBuffer) + tasksSize);
+
+		uint8_t* channelBuffer = nullptr;
+		if (!ReadChannelSources(file, allocator, context, layer, channelSources, channelBuffer))
+		{
+			ReleaseScratchBuffer(allocator, context, taskBuffer);
+			return;
+		}
+
+		// channel data is stored in 4 different formats, which is denoted by a 2-byte integer.
+		// each channel is decoded by a separate task, and RLE-compressed channels are split further into bands of rows when
+		// running on several threads. 8-bit RAW channels that are accessible in memory can be borrowed without decoding.
+		const bool canBorrow = borrowRawData && !channelBuffer && (document->bitsPerChannel == 8u);
+		unsigned int taskCount = 0u;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			Channel* channel = &layer->channels[i];
+			PSD_ASSERT(channel->data == nullptr, "Channel data has already been loaded.");
+			if (channel->size >= sizeof(uint16_t))
+			{
+				unsigned int width = 0u;
+				unsigned int height = 0u;
+				GetChannelExtents(layer, channel, width, height);
+
+				if (canBorrow && BorrowChannelDataRaw(channel, channelSources[i], width, height))
+				{
+					continue;
+				}
+
+				taskCount += AddDecodeTasks(document, allocator, channel, channelSources[i], width, height, threadCount, tasks + taskCount);
+			}
+		}
+
+		// a context must not be shared by several threads, so it is only used when decoding on the calling thread
+		DecodeContext* taskContext = (threadCount > 1u) ? nullptr : context;
+		threadUtil::ParallelFor(taskCount, threadCount, [=](unsigned int i)
+		{
+			RunDecodeTask(document, allocator, taskContext, tasks[i]);
+		});
+
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			Channel* channel = &layer->channels[i];
+
+			// if the channel doesn't have any data assigned to it, check if it is a mask channel of any kind.
+			// layer masks sometimes don't have any planar data stored for them, because they are
+			// e.g. pure black or white, which means they only get assigned a default color.
+			if (!channel->data)
+			{
+				if (channel->type < 0)
+				{
+					unsigned int width = 0u;
+					unsigned int height = 0u;
+					GetChannelExtents(layer, channel, width, height);
+
+					// this is a layer mask, so create planar data for it
+					const size_t dataSize = static_cast<size_t>(width)*height*document->bitsPerChannel / 8u;
+					void* channelData = allocator->Allocate(dataSize, 16u, allocationTag::CHANNEL_DATA);
+					memset(channelData, GetChannelDefaultColor(layer, channel), dataSize);
+					channel->data = channelData;
+				}
+				else
+				{
+					// for layers like groups and group end markers ("</Layer group>") it is ok to not store any data
+				}
+			}
+		}
+
+		ReleaseScratchBuffer(allocator, context, channelBuffer);
+		ReleaseScratchBuffer(allocator, context, taskBuffer);
+
+		// now move channel data to our own data structures for layer and vector masks, invalidating the info stored in
+		// that channel.
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			Channel* channel = &layer->channels[i];
+			if (channel->type == channelType::LAYER_OR_VECTOR_MASK)
+			{
+				if (layer->vectorMask)
+				{
+					// layer has a vector mask, so this type always denotes the vector mask
+					PSD_ASSERT(!layer->vectorMask->data, "Vector mask data has already been assigned.");
+					MoveChannelToMask(channel, layer->vectorMask);
+				}
+				else if (layer->layerMask)
+				{
+					// we don't have a vector but a layer mask, so this type denotes the layer mask
+					PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
+					MoveChannelToMask(channel, layer->layerMask);
+				}
+				else
+				{
+					PSD_ASSERT(false, "The code failed to create a mask for this type internally. This should never happen.");
+				}
+			}
+			else if (channel->type == channelType::LAYER_MASK)
+			{
+				PSD_ASSERT(layer->layerMask, "Layer mask must already exist.");
+				PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
+				MoveChannelToMask(channel, layer->layerMask);
+			}
+			else
+			{
+				// this channel is either a color channel, or the transparency mask. those should be stored in our channel array,
+				// so there's nothing to do.
+			}
+		}
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Allocator* allocator)
+{
+	return ParseLayerMaskSection(document, file, allocator, true);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LayerMaskSection* ParseLayerMaskSectionIndex(const Document* document, File* file, Allocator* allocator)
+{
+	return ParseLayerMaskSection(document, file, allocator, false);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ParseLayerRecord(const Document* document, File* file, Allocator* allocator, Layer* layer)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+
+	if (layer->isRecordParsed)
+	{
+		return;
+	}
 
-			// walk through the layers and channels, but don't extract their data just yet. only save the file offset for extracting the
-			// data later.
-			for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
-			{
-				Layer* layer = &layerMaskSection->layers[i];
-				const unsigned int channelCount = layer->channelCount;
-				for (unsigned int j=0; j < channelCount; ++j)
-				{
-					Channel* channel = &layer->channels[j];
-					channel->fileOffset = reader.GetPosition();
-					reader.Skip(channel->size);
-				}
-			}
-		}
+	SyncFileReader reader(file, allocator);
+	reader.SetPosition(layer->recordOffset);
+	ReadLayerExtraData(document, reader, allocator, layer, layer->recordLength);
+}
 
-		if (sectionLength > 0)
-		{
-			// start loading at the global layer mask info section, located after the Layer Information Section.
-			// note that the 4 bytes that stored the length of the section are not included in the length itself.
-			const uint64_t globalInfoSectionOffset = sectionOffset + layerLength + 4u;
-			reader.SetPosition(globalInfoSectionOffset);
 
-			// work out how many bytes are left to read at this point. we need that to figure out the size of the last
-			// optional section, the Additional Layer Information.
-			if (sectionOffset + sectionLength > globalInfoSectionOffset)
-			{
-				int64_t toRead = static_cast<int64_t>(sectionOffset + sectionLength - globalInfoSectionOffset);
-				const uint32_t globalLayerMaskLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-				toRead -= sizeof(uint32_t);
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer)
+{
+	ExtractLayer(document, file, allocator, layer, 1u);
+}
 
-				if (globalLayerMaskLength != 0)
-				{
-					layerMaskSection->overlayColorSpace = fileUtil::ReadFromFileBE<uint16_t>(reader);
 
-					// 4*2 byte color components
-					reader.Skip(8);
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, unsigned int threadCount)
+{
+	ExtractLayerData(document, file, allocator, layer, threadCount, nullptr, false);
+}
 
-					layerMaskSection->opacity = fileUtil::ReadFromFileBE<uint16_t>(reader);
-					layerMaskSection->kind = fileUtil::ReadFromFileBE<uint8_t>(reader);
 
-					toRead -= 2u*sizeof(uint16_t) + sizeof(uint8_t) + 8u;
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, DecodeContext* context)
+{
+	PSD_ASSERT_NOT_NULL(context);
 
-					// filler bytes (zeroes)
-					const uint32_t remaining = globalLayerMaskLength - 2u*sizeof(uint16_t) - sizeof(uint8_t) - 8u;
-					reader.Skip(remaining);
+	ExtractLayerData(document, file, allocator, layer, 1u, context, false);
+}
 
-					toRead -= remaining;
-				}
 
-				// are there still bytes left to read? then this is the Additional Layer Information that exists since Photoshop 4.0.
-				while (toRead > 0)
-				{
-					const uint32_t signature = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					if (signature != util::Key<'8', 'B', 'I', 'M'>::VALUE)
-					{
-						PSD_ERROR("AdditionalLayerInfo", "Additional Layer Information section seems to be corrupt, signature does not match \"8BIM\".");
-						return layerMaskSection;
-					}
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ExtractLayerBorrowed(const Document* document, File* file, Allocator* allocator, Layer* layer, DecodeContext* context)
+{
+	ExtractLayerData(document, file, allocator, layer, 1u, context, true);
+}
 
-					const uint32_t key = fileUtil::ReadFromFileBE<uint32_t>(reader);
 
-					// again, length is rounded to a multiple of 4
-					uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					length = bitUtil::RoundUpToMultiple(length, 4u);
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+DecodeContext* CreateDecodeContext(Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(allocator);
 
-					if (key == util::Key<'L', 'r', '1', '6'>::VALUE)
-					{
-						const uint64_t offset = reader.GetPosition();
-						DestroyLayerMaskSection(layerMaskSection, allocator);
-						layerMaskSection = ParseLayer(document, reader, allocator, 0u, 0u, length);
-						reader.SetPosition(offset + length);
-					}
-					else if (key == util::Key<'L', 'r', '3', '2'>::VALUE)
-					{
-						const uint64_t offset = reader.GetPosition();
-						DestroyLayerMaskSection(layerMaskSection, allocator);
-						layerMaskSection = ParseLayer(document, reader, allocator, 0u, 0u, length);
-						reader.SetPosition(offset + length);
-					}
-					else if (key == util::Key<'v', 'm', 's', 'k'>::VALUE)
-					{
-						// TODO: could read extra vector mask data here
-						reader.Skip(length);
-					}
-					else if (key == util::Key<'l', 'n', 'k', '2'>::VALUE)
-					{
-						// TODO: could read individual smart object layer data here
-						reader.Skip(length);
-					}
-					else
-					{
-						reader.Skip(length);
-					}
+	DecodeContext* context = memoryUtil::Allocate<DecodeContext>(allocator);
+	for (unsigned int i=0; i < decodeBuffer::COUNT; ++i)
+	{
+		context->buffers[i] = nullptr;
+		context->sizes[i] = 0u;
+	}
 
-					toRead -= 3u*sizeof(uint32_t) + length;
-				}
-			}
-		}
+	return context;
+}
 
-		return layerMaskSection;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyDecodeContext(DecodeContext*& context, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(context);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	for (unsigned int i=0; i < decodeBuffer::COUNT; ++i)
+	{
+		allocator->Free(context->buffers[i]);
 	}
+
+	memoryUtil::Free(allocator, context);
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
-LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Allocator* allocator)
+void* ExtractLayerInterleaved(const Document* document, File* file, Allocator* allocator, Layer* layer, unsigned int outputBitsPerChannel)
 {
 	PSD_ASSERT_NOT_NULL(file);
 	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
 
-	// if there are no layers or masks, this section is just 4 bytes: the length field, which is set to zero.
-	const Section& section = document->layerMaskInfoSection;
-	if (section.length == 0)
+	const unsigned int bitsPerChannel = document->bitsPerChannel;
+	if ((outputBitsPerChannel != 8u) && (outputBitsPerChannel != bitsPerChannel))
 	{
-		PSD_ERROR("PSD", "Document does not contain a layer mask section.");
+		PSD_ERROR("PsdExtract", "Cannot convert %u bits per channel to %u bits per channel.", bitsPerChannel, outputBitsPerChannel);
 		return nullptr;
 	}
 
-	SyncFileReader reader(file);
-	reader.SetPosition(section.offset);
+	if ((layer->right <= layer->left) || (layer->bottom <= layer->top))
+	{
+		// layers like groups and group end markers don't store any data
+		return nullptr;
+	}
 
-	const uint32_t layerInfoSectionLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-	LayerMaskSection* layerMaskSection = ParseLayer(document, reader, allocator, section.offset, section.length, layerInfoSectionLength);
+	int channelIndices[4] = {};
+	if (!FindColorChannels(layer, channelIndices))
+	{
+		return nullptr;
+	}
 
-	// build the layer hierarchy
-	if (layerMaskSection && layerMaskSection->layers)
+	const uint8_t** channelSources = memoryUtil::AllocateArray<const uint8_t*>(allocator, layer->channelCount, allocationTag::DECODE_SCRATCH);
+	uint8_t* channelBuffer = nullptr;
+	if (!ReadChannelSources(file, allocator, nullptr, layer, channelSources, channelBuffer))
 	{
-		Layer* layerStack[256] = {};
-		layerStack[0] = nullptr;
-		int stackIndex = 0;
+		memoryUtil::FreeArray(allocator, channelSources);
+		return nullptr;
+	}
 
-		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
-		{
-			// note that it is much easier to build the hierarchy by traversing the layers backwards
-			Layer* layer = &layerMaskSection->layers[layerMaskSection->layerCount - i - 1u];
+	void* image = nullptr;
+	if (bitsPerChannel == 8)
+	{
+		image = ExtractLayerInterleaved<uint8_t, uint8_t>(document, allocator, layer, channelSources, channelIndices);
+	}
+	else if (bitsPerChannel == 16)
+	{
+		image = (outputBitsPerChannel == 8)
+			? ExtractLayerInterleaved<uint8_t, uint16_t>(document, allocator, layer, channelSources, channelIndices)
+			: ExtractLayerInterleaved<uint16_t, uint16_t>(document, allocator, layer, channelSources, channelIndices);
+	}
+	else if (bitsPerChannel == 32)
+	{
+		image = (outputBitsPerChannel == 8)
+			? ExtractLayerInterleaved<uint8_t, float32_t>(document, allocator, layer, channelSources, channelIndices)
+			: ExtractLayerInterleaved<float32_t, float32_t>(document, allocator, layer, channelSources, channelIndices);
+	}
 
-			PSD_ASSERT(stackIndex >= 0 && stackIndex < 256, "Stack index is out of bounds.");
-			layer->parent = layerStack[stackIndex];
+	allocator->Free(channelBuffer);
+	memoryUtil::FreeArray(allocator, channelSources);
 
-			unsigned int width = 0u;
-			unsigned int height = 0u;
-			GetExtents(layer, width, height);
+	return image;
+}
 
-			const bool isGroupStart = (layer->type == layerType::OPEN_FOLDER) || (layer->type == layerType::CLOSED_FOLDER);
-			const bool isGroupEnd = (layer->type == layerType::SECTION_DIVIDER);
-			if (isGroupEnd)
-			{
-				--stackIndex;
-			}
-			else if (isGroupStart)
-			{
-				++stackIndex;
-				layerStack[stackIndex] = layer;
-			}
-		}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* ExtractLayerRegion(const Document* document, File* file, Allocator* allocator, Layer* layer, int left, int top, int right, int bottom, unsigned int outputBitsPerChannel)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+
+	const unsigned int bitsPerChannel = document->bitsPerChannel;
+	if ((outputBitsPerChannel != 8u) && (outputBitsPerChannel != bitsPerChannel))
+	{
+		PSD_ERROR("PsdExtract", "Cannot convert %u bits per channel to %u bits per channel.", bitsPerChannel, outputBitsPerChannel);
+		return nullptr;
+	}
+
+	if ((right <= left) || (bottom <= top))
+	{
+		PSD_ERROR("PsdExtract", "Region (%d, %d, %d, %d) is empty.", left, top, right, bottom);
+		return nullptr;
+	}
+
+	// layers without image data, e.g. groups, do not cover any part of the region, which is therefore fully transparent
+	int channelIndices[4] = { -1, -1, -1, -1 };
+	const bool hasImageData = (layer->right > layer->left) && (layer->bottom > layer->top) && (layer->channelCount != 0u);
+	if (hasImageData && !FindColorChannels(layer, channelIndices))
+	{
+		return nullptr;
+	}
+
+	void* image = nullptr;
+	if (bitsPerChannel == 8)
+	{
+		image = ExtractLayerRegion<uint8_t, uint8_t>(document, file, allocator, layer, channelIndices, left, top, right, bottom);
+	}
+	else if (bitsPerChannel == 16)
+	{
+		image = (outputBitsPerChannel == 8)
+			? ExtractLayerRegion<uint8_t, uint16_t>(document, file, allocator, layer, channelIndices, left, top, right, bottom)
+			: ExtractLayerRegion<uint16_t, uint16_t>(document, file, allocator, layer, channelIndices, left, top, right, bottom);
+	}
+	else if (bitsPerChannel == 32)
+	{
+		image = (outputBitsPerChannel == 8)
+			? ExtractLayerRegion<uint8_t, float32_t>(document, file, allocator, layer, channelIndices, left, top, right, bottom)
+			: ExtractLayerRegion<float32_t, float32_t>(document, file, allocator, layer, channelIndices, left, top, right, bottom);
 	}
 
-	return layerMaskSection;
+	return image;
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
-void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer)
+bool ExtractLayerRows(const Document* document, File* file, Allocator* allocator, Layer* layer, const int16_t* channelTypes, unsigned int channelCount, RowSink* sink)
 {
 	PSD_ASSERT_NOT_NULL(file);
 	PSD_ASSERT_NOT_NULL(allocator);
 	PSD_ASSERT_NOT_NULL(layer);
+	PSD_ASSERT_NOT_NULL(sink);
 
-	SyncFileReader reader(file);
+	if ((layer->right <= layer->left) || (layer->bottom <= layer->top) || (channelCount == 0u))
+	{
+		// layers like groups and group end markers don't store any data
+		return true;
+	}
 
-	const unsigned int channelCount = layer->channelCount;
+	// masks have their own extents, so only the color channels and the transparency mask can be streamed together
+	int* channelIndices = memoryUtil::AllocateArray<int>(allocator, channelCount, allocationTag::DECODE_SCRATCH);
+	bool success = true;
 	for (unsigned int i=0; i < channelCount; ++i)
 	{
-		Channel* channel = &layer->channels[i];
-		reader.SetPosition(channel->fileOffset);
-
-		unsigned int width = 0u;
-		unsigned int height = 0u;
-		GetChannelExtents(layer, channel, width, height);
-
-		// channel data is stored in 4 different formats, which is denoted by a 2-byte integer
-		PSD_ASSERT(channel->data == nullptr, "Channel data has already been loaded.");
-		const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
-		if (compressionType == compressionType::RAW)
+		channelIndices[i] = -1;
+		for (unsigned int j=0; j < layer->channelCount; ++j)
 		{
-			if (document->bitsPerChannel == 8)
-			{
-				channel->data = ReadChannelDataRaw<uint8_t>(reader, allocator, width, height);
-			}
-			else if (document->bitsPerChannel == 16)
-			{
-				channel->data = ReadChannelDataRaw<uint16_t>(reader, allocator, width, height);
-			}
-			else if (document->bitsPerChannel == 32)
+			if (layer->channels[j].type == channelTypes[i])
 			{
-				channel->data = ReadChannelDataRaw<float32_t>(reader, allocator, width, height);
+				channelIndices[i] = static_cast<int>(j);
+				break;
 			}
 		}
-		else if (compressionType == compressionType::RLE)
+
+		if ((channelIndices[i] < 0) || (channelTypes[i] < channelType::TRANSPARENCY_MASK))
 		{
-			if (document->bitsPerChannel == 8)
-			{
-				channel->data = ReadChannelDataRLE<uint8_t>(reader, allocator, width, height);
-			}
-			else if (document->bitsPerChannel == 16)
-			{
-				channel->data = ReadChannelDataRLE<uint16_t>(reader, allocator, width, height);
-			}
-			else if (document->bitsPerChannel == 32)
-			{
-				channel->data = ReadChannelDataRLE<float32_t>(reader, allocator, width, height);
-			}
+			PSD_ERROR("PsdExtract", "Channel %d of layer \"%s\" cannot be streamed.", channelTypes[i], layer->name.c_str());
+			success = false;
 		}
-		else if (compressionType == compressionType::ZIP)
+	}
+
+	if (success)
+	{
+		const unsigned int bitsPerChannel = document->bitsPerChannel;
+		if (bitsPerChannel == 8)
 		{
-			// note that we need to subtract 2 bytes from the channel data size because we already read the uint16_t
-			// for the compression type.
-			PSD_ASSERT(channel->size >= 2, "Invalid channel data size %d.", channel->size);
-			const uint32_t channelDataSize = channel->size - 2u;
-			if (document->bitsPerChannel == 8)
-			{
-				channel->data = ReadChannelDataZip<uint8_t>(reader, allocator, width, height, channelDataSize);
-			}
-			else if (document->bitsPerChannel == 16)
-			{
-				channel->data = ReadChannelDataZip<uint16_t>(reader, allocator, width, height, channelDataSize);
-			}
-			else if (document->bitsPerChannel == 32)
-			{
-				// note that this is NOT a bug.
-				// in 32-bit mode, Photoshop always interprets ZIP compression as being ZIP_WITH_PREDICTION, presumably to get better compression when writing files.
-				channel->data = ReadChannelDataZipPrediction<float32_t>(reader, allocator, width, height, channelDataSize);
-			}
+			success = ExtractLayerRows<uint8_t>(document, file, allocator, layer, channelIndices, channelCount, sink);
 		}
-		else if (compressionType == compressionType::ZIP_WITH_PREDICTION)
+		else if (bitsPerChannel == 16)
 		{
-			// note that we need to subtract 2 bytes from the channel data size because we already read the uint16_t
-			// for the compression type.
-			PSD_ASSERT(channel->size >= 2, "Invalid channel data size %d.", channel->size);
-			const uint32_t channelDataSize = channel->size - 2u;
-			if (document->bitsPerChannel == 8)
-			{
-				channel->data = ReadChannelDataZipPrediction<uint8_t>(reader, allocator, width, height, channelDataSize);
-			}
-			else if (document->bitsPerChannel == 16)
-			{
-				channel->data = ReadChannelDataZipPrediction<uint16_t>(reader, allocator, width, height, channelDataSize);
-			}
-			else if (document->bitsPerChannel == 32)
-			{
-				channel->data = ReadChannelDataZipPrediction<float32_t>(reader, allocator, width, height, channelDataSize);
-			}
+			success = ExtractLayerRows<uint16_t>(document, file, allocator, layer, channelIndices, channelCount, sink);
 		}
-		else
+		else if (bitsPerChannel == 32)
 		{
-			PSD_ASSERT(false, "Unsupported compression type %d", compressionType);
-			return;
+			success = ExtractLayerRows<float32_t>(document, file, allocator, layer, channelIndices, channelCount, sink);
 		}
-
-		// if the channel doesn't have any data assigned to it, check if it is a mask channel of any kind.
-		// layer masks sometimes don't have any planar data stored for them, because they are
-		// e.g. pure black or white, which means they only get assigned a default color.
-		if (!channel->data)
+		else
 		{
-			if (channel->type < 0)
-			{
-				// this is a layer mask, so create planar data for it
-				const size_t dataSize = width * height * document->bitsPerChannel / 8u;
-				void* channelData = allocator->Allocate(dataSize, 16u);
-				memset(channelData, GetChannelDefaultColor(layer, channel), dataSize);
-				channel->data = channelData;
-			}
-			else
-			{
-				// for layers like groups and group end markers ("</Layer group>") it is ok to not store any data
-			}
+			PSD_ERROR("PsdExtract", "Unhandled bits per channel: %u.", bitsPerChannel);
+			success = false;
 		}
 	}
 
-	// now move channel data to our own data structures for layer and vector masks, invalidating the info stored in
-	// that channel.
-	for (unsigned int i=0; i < channelCount; ++i)
+	memoryUtil::FreeArray(allocator, channelIndices);
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ExtractLayersParallel(const Document* document, File* file, Allocator* allocator, Layer* layers, unsigned int count, unsigned int threadCount)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	if (count == 0u)
 	{
-		Channel* channel = &layer->channels[i];
-		if (channel->type == channelType::LAYER_OR_VECTOR_MASK)
-		{
-			if (layer->vectorMask)
-			{
-				// layer has a vector mask, so this type always denotes the vector mask
-				PSD_ASSERT(!layer->vectorMask->data, "Vector mask data has already been assigned.");
-				MoveChannelToMask(channel, layer->vectorMask);
-			}
-			else if (layer->layerMask)
-			{
-				// we don't have a vector but a layer mask, so this type denotes the layer mask
-				PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
-				MoveChannelToMask(channel, layer->layerMask);
-			}
-			else
-			{
-				PSD_ASSERT(false, "The code failed to create a mask for this type internally. This should never happen.");
-			}
-		}
-		else if (channel->type == channelType::LAYER_MASK)
+		return;
+	}
+
+	PSD_ASSERT_NOT_NULL(layers);
+
+	// schedule the layers with the most channel data first, so that one huge layer does not end up being extracted
+	// by a single thread at the very end, while all other threads are already idle.
+	unsigned int* order = memoryUtil::AllocateArray<unsigned int>(allocator, count, allocationTag::DECODE_SCRATCH);
+	uint64_t* sizes = memoryUtil::AllocateArray<uint64_t>(allocator, count, allocationTag::DECODE_SCRATCH);
+	for (unsigned int i=0; i < count; ++i)
+	{
+		uint64_t size = 0u;
+		for (unsigned int j=0; j < layers[i].channelCount; ++j)
 		{
-			PSD_ASSERT(layer->layerMask, "Layer mask must already exist.");
-			PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
-			MoveChannelToMask(channel, layer->layerMask);
+			size += layers[i].channels[j].size;
 		}
-		else
+
+		order[i] = i;
+		sizes[i] = size;
+	}
+
+	std::stable_sort(order, order + count, [sizes](unsigned int a, unsigned int b)
+	{
+		return sizes[a] > sizes[b];
+	});
+
+	if (threadCount == 0u)
+	{
+		threadCount = threadUtil::GetHardwareThreadCount();
+	}
+
+	const unsigned int workerCount = std::min(std::min(threadCount, count), threadUtil::MAX_THREAD_COUNT);
+
+	// each worker owns a context, so the scratch buffers needed for decoding are only allocated once per worker instead of
+	// once per layer. workers pick the next layer in order, and each call to ExtractLayer uses its own reader and only
+	// touches the data of its own layer.
+	DecodeContext** contexts = memoryUtil::AllocateArray<DecodeContext*>(allocator, workerCount, allocationTag::DECODE_SCRATCH);
+	for (unsigned int i=0; i < workerCount; ++i)
+	{
+		contexts[i] = CreateDecodeContext(allocator);
+	}
+
+	std::atomic<unsigned int> next(0u);
+	threadUtil::ParallelFor(workerCount, workerCount, [&](unsigned int worker)
+	{
+		for (unsigned int i = next.fetch_add(1u); i < count; i = next.fetch_add(1u))
 		{
-			// this channel is either a color channel, or the transparency mask. those should be stored in our channel array,
-			// so there's nothing to do.
+			ExtractLayer(document, file, allocator, &layers[order[i]], contexts[worker]);
 		}
+	});
+
+	for (unsigned int i=0; i < workerCount; ++i)
+	{
+		DestroyDecodeContext(contexts[i], allocator);
 	}
+
+	memoryUtil::FreeArray(allocator, contexts);
+	memoryUtil::FreeArray(allocator, sizes);
+	memoryUtil::FreeArray(allocator, order);
 }
 
 
@@ -1082,7 +2471,10 @@ void DestroyLayerMaskSection(LayerMaskSection*& section, Allocator* allocator)
 		for (unsigned int j=0; j < layer->channelCount; ++j)
 		{
 			Channel* channel = &layer->channels[j];
-			allocator->Free(channel->data);
+			if (!channel->isDataBorrowed)
+			{
+				allocator->Free(channel->data);
+			}
 		}
 
 		memoryUtil::FreeArray(allocator, layer->utf16Name);
@@ -9,6 +9,8 @@ PSD_NAMESPACE_BEGIN
 struct Document;
 class File;
 class Allocator;
+class RowSink;
+struct DecodeContext;
 struct Layer;
 struct LayerMaskSection;
 
@@ -22,10 +24,91 @@ struct LayerMaskSection;
 LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Allocator* allocator);
 
 /// \ingroup Parser
-/// Extracts data for a given \a layer.
+/// Parses the layer mask section in the document like \ref ParseLayerMaskSection, but only builds an index of the layers.
+/// The index stores each layer's bounds, channels, blend mode, opacity, flags and type, which is enough to build the layer hierarchy.
+/// Names, masks and all other additional layer information are only parsed by a call to \ref ParseLayerRecord, which
+/// \ref ExtractLayer does automatically. The returned instance needs to be freed by a call to \ref DestroyLayerMaskSection.
+LayerMaskSection* ParseLayerMaskSectionIndex(const Document* document, File* file, Allocator* allocator);
+
+/// \ingroup Parser
+/// Parses the name, masks and additional layer information of a \a layer that belongs to a section created by a call to
+/// \ref ParseLayerMaskSectionIndex. Does nothing if this information has already been parsed.
+/// \remark It is valid to parse the records of individual layers from multiple threads in parallel.
+void ParseLayerRecord(const Document* document, File* file, Allocator* allocator, Layer* layer);
+
+/// \ingroup Parser
+/// Extracts data for a given \a layer. If the layer's record has not been parsed yet, \ref ParseLayerRecord is called first.
 /// \remark It is valid and suggested to extract the data of individual layers from multiple threads in parallel.
 void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer);
 
+/// \ingroup Parser
+/// Extracts data for a given \a layer like \ref ExtractLayer, but decodes its channels in parallel using up to \a threadCount
+/// threads including the calling thread. RLE-compressed channels are additionally split into bands of rows that are decoded
+/// independently. A \a threadCount of 0 uses all hardware threads.
+/// \remark If \a threadCount is not 1, \a allocator is used from multiple threads concurrently, and must therefore be thread-safe.
+void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, unsigned int threadCount);
+
+/// \ingroup Parser
+/// Extracts data for a given \a layer like \ref ExtractLayer, but takes all scratch memory needed while decoding from the given
+/// \a context instead of allocating and freeing it for each layer. Only the channel data itself is allocated using \a allocator.
+/// \remark The \a context must not be used by other threads at the same time, but each thread can use a context of its own.
+/// Its buffers grow using \a allocator, which therefore needs to be the allocator the context was created with.
+void ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, DecodeContext* context);
+
+/// \ingroup Parser
+/// Extracts data for a given \a layer like \ref ExtractLayer, but does not copy 8-bit RAW-compressed color and transparency channels
+/// if the \a file holds the layer's data in memory, e.g. a \ref MappedFile or \ref MemoryFile. The data of those channels points
+/// directly into the file's memory instead, which is denoted by \ref Channel::isDataBorrowed. Borrowed data is only valid while
+/// the file is open, must not be modified, and is not necessarily aligned to 16 bytes. It is not freed by \ref DestroyLayerMaskSection.
+/// All other channels, and all layer and vector masks, are decoded as usual. If \a context is not nullptr, scratch memory is taken
+/// from it like in \ref ExtractLayer.
+void ExtractLayerBorrowed(const Document* document, File* file, Allocator* allocator, Layer* layer, DecodeContext* context);
+
+/// \ingroup Parser
+/// Creates a context holding scratch buffers for extracting layers, see \ref ExtractLayer. The returned instance needs to be
+/// freed by a call to \ref DestroyDecodeContext.
+DecodeContext* CreateDecodeContext(Allocator* allocator);
+
+/// \ingroup Parser
+/// Destroys and nullifies the given \a context previously created by a call to \ref CreateDecodeContext.
+void DestroyDecodeContext(DecodeContext*& context, Allocator* allocator);
+
+/// \ingroup Parser
+/// Extracts the R, G, B and transparency channels of a \a layer directly into a newly allocated, interleaved RGBA image
+/// of the layer's size, with \a outputBitsPerChannel being either 8 or the document's bits per channel.
+/// RAW and RLE-compressed channels are decoded, endian-converted, converted and interleaved row by row, so each row is
+/// only touched while it is still in the cache. Missing transparency data is treated as fully opaque.
+/// The layer's channel data is not assigned, use \ref ExtractLayer to access individual channels and masks.
+/// Returns nullptr if the layer does not store any image data. The image needs to be freed using \a allocator.
+void* ExtractLayerInterleaved(const Document* document, File* file, Allocator* allocator, Layer* layer, unsigned int outputBitsPerChannel);
+
+/// \ingroup Parser
+/// Extracts the part of a \a layer that lies inside the region given by \a left, \a top, \a right and \a bottom in canvas coordinates
+/// into a newly allocated, interleaved RGBA image of the region's size, like \ref ExtractLayerInterleaved.
+/// Only rows intersecting the region are decoded. If the layer's data is not accessible in memory, only those rows of RAW and
+/// RLE-compressed channels are read from the file. Pixels of the region that are not covered by the layer are fully transparent,
+/// which is the whole region for layers without image data, e.g. groups.
+/// Returns nullptr if the region is empty. The image needs to be freed using \a allocator.
+void* ExtractLayerRegion(const Document* document, File* file, Allocator* allocator, Layer* layer, int left, int top, int right, int bottom, unsigned int outputBitsPerChannel);
+
+/// \ingroup Parser
+/// Extracts the channels of a \a layer given by the \a channelCount \a channelTypes row by row, and passes each row of all channels
+/// to the \a sink as soon as it has been decoded, see \ref RowSink. Only channels having the layer's extents can be streamed,
+/// i.e. the color channels and the transparency mask. Channels that are stored without data yield rows of zeroes.
+/// If the layer's data is not accessible in memory, RAW and RLE-compressed data is read from the file in small bands of rows,
+/// so that memory usage does not depend on the layer's height. ZIP-compressed channels are inflated row by row as well,
+/// but their compressed data is read from the file as a whole.
+/// The layer's channel data is not assigned. Returns false if a channel cannot be streamed, or the sink stopped the extraction.
+bool ExtractLayerRows(const Document* document, File* file, Allocator* allocator, Layer* layer, const int16_t* channelTypes, unsigned int channelCount, RowSink* sink);
+
+/// \ingroup Parser
+/// Extracts data for \a count \a layers in parallel, using up to \a threadCount threads including the calling thread.
+/// Layers are scheduled largest-first, and the function returns once all layers have been extracted. Each thread reuses
+/// its own scratch buffers for all layers it extracts.
+/// A \a threadCount of 0 uses all hardware threads.
+/// \remark Both \a file and \a allocator are used from multiple threads concurrently, and must therefore be thread-safe.
+void ExtractLayersParallel(const Document* document, File* file, Allocator* allocator, Layer* layers, unsigned int count, unsigned int threadCount);
+
 /// \ingroup Parser
 /// Destroys and nullifies the given \a section previously created by a call to \ref ParseLayerMaskSection.
 void DestroyLayerMaskSection(LayerMaskSection*& section, Allocator* allocator);
@@ -0,0 +1,345 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdPooledAllocator.h"
+
+#include "PsdAssert.h"
+#include "PsdBitUtil.h"
+#include "PsdThreadUtil.h"
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#if defined(__linux__)
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// the smallest size class, and the number of size classes per power-of-two above it
+	static const size_t MIN_CLASS_SIZE = 64u;
+	static const unsigned int MIN_CLASS_SHIFT = 6u;
+	static const unsigned int CLASSES_PER_POWER_OF_TWO = 4u;
+
+	// larger allocations are rare, and are passed on to the backing allocator
+	static const unsigned int MAX_CLASS_SHIFT = 28u;
+	static const size_t MAX_POOLED_SIZE = size_t(1u) << MAX_CLASS_SHIFT;
+	static const unsigned int SIZE_CLASS_COUNT = 1u + (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT)*CLASSES_PER_POWER_OF_TWO;
+	static const uint32_t UNPOOLED_CLASS = 0xFFFFFFFFu;
+
+	// blocks are allocated with room for the header and for aligning the allocation to this alignment
+	static const size_t MAX_POOLED_ALIGNMENT = 64u;
+	static const size_t BLOCK_ALIGNMENT = 16u;
+
+	// transparent huge pages are 2 MB on all common configurations
+	static const size_t HUGE_PAGE_SIZE = 2u*1024u*1024u;
+
+	// each thread picks the cache with its index, modulo the number of caches
+	static const unsigned int CACHE_COUNT = threadUtil::MAX_THREAD_COUNT;
+
+
+	/// Stored right in front of each allocation, so that freeing it knows where its block starts and which class it belongs to.
+	struct BlockHeader
+	{
+		void* block;
+		uint32_t sizeClass;
+		uint32_t padding[sizeof(void*) == 4u ? 2u : 1u];
+	};
+
+	static_assert(sizeof(BlockHeader) == BLOCK_ALIGNMENT, "Block header must not change the alignment of allocations.");
+
+
+	/// Cached blocks are linked through their first bytes, which are unused while the block sits in a free list.
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+
+	static std::atomic<unsigned int> g_nextThreadIndex(0u);
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetThreadIndex(void)
+	{
+		static thread_local unsigned int threadIndex = g_nextThreadIndex.fetch_add(1u, std::memory_order_relaxed);
+		return threadIndex;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t GetSizeClass(size_t size)
+	{
+		if (size <= MIN_CLASS_SIZE)
+		{
+			return 0u;
+		}
+
+		// find the power-of-two below the size, and divide the range up to the next power-of-two into equal steps
+		unsigned int shift = MIN_CLASS_SHIFT;
+		while ((size - 1u) >> (shift + 1u))
+		{
+			++shift;
+		}
+
+		const unsigned int stepShift = shift - 2u;
+		const size_t step = (size - (size_t(1u) << shift) + (size_t(1u) << stepShift) - 1u) >> stepShift;
+		return static_cast<uint32_t>(1u + (shift - MIN_CLASS_SHIFT)*CLASSES_PER_POWER_OF_TWO + step - 1u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t GetClassSize(uint32_t sizeClass)
+	{
+		if (sizeClass == 0u)
+		{
+			return MIN_CLASS_SIZE;
+		}
+
+		const unsigned int shift = MIN_CLASS_SHIFT + (sizeClass - 1u) / CLASSES_PER_POWER_OF_TWO;
+		const size_t step = (sizeClass - 1u) % CLASSES_PER_POWER_OF_TWO + 1u;
+		return (size_t(1u) << shift) + (step << (shift - 2u));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static size_t GetBlockSize(uint32_t sizeClass)
+	{
+		// the header and alignment of an allocation always fit into the first MAX_POOLED_ALIGNMENT bytes of a block
+		return GetClassSize(sizeClass) + MAX_POOLED_ALIGNMENT;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static BlockHeader* GetHeader(void* ptr)
+	{
+		return reinterpret_cast<BlockHeader*>(static_cast<uint8_t*>(ptr) - sizeof(BlockHeader));
+	}
+}
+
+
+/// A per-thread cache holding one free list for each size class.
+struct PooledAllocator::Cache
+{
+	Cache(void)
+		: cachedSize(0u)
+	{
+		for (unsigned int i=0; i < SIZE_CLASS_COUNT; ++i)
+		{
+			freeLists[i] = nullptr;
+		}
+	}
+
+	std::mutex mutex;						///< Only contended if more threads than caches are in use, or blocks are trimmed.
+	FreeBlock* freeLists[SIZE_CLASS_COUNT];
+	size_t cachedSize;
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+PooledAllocator::PooledAllocator(Allocator* backingAllocator, size_t maxCachedSizePerThread, bool useHugePages)
+	: m_backingAllocator(backingAllocator)
+	, m_maxCachedSizePerThread(maxCachedSizePerThread)
+	, m_useHugePages(useHugePages)
+	, m_caches(nullptr)
+{
+	PSD_ASSERT_NOT_NULL(backingAllocator);
+
+	void* memory = backingAllocator->Allocate(sizeof(Cache)*CACHE_COUNT, PSD_ALIGN_OF(Cache));
+	m_caches = static_cast<Cache*>(memory);
+	for (unsigned int i=0; i < CACHE_COUNT; ++i)
+	{
+		new (&m_caches[i]) Cache;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+PooledAllocator::~PooledAllocator(void)
+{
+	Trim();
+
+	for (unsigned int i=0; i < CACHE_COUNT; ++i)
+	{
+		m_caches[i].~Cache();
+	}
+
+	m_backingAllocator->Free(m_caches);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void PooledAllocator::Trim(void)
+{
+	for (unsigned int i=0; i < CACHE_COUNT; ++i)
+	{
+		Cache& cache = m_caches[i];
+		std::lock_guard<std::mutex> lock(cache.mutex);
+
+		for (unsigned int j=0; j < SIZE_CLASS_COUNT; ++j)
+		{
+			FreeBlock* block = cache.freeLists[j];
+			while (block)
+			{
+				FreeBlock* next = block->next;
+				m_backingAllocator->Free(block);
+				block = next;
+			}
+
+			cache.freeLists[j] = nullptr;
+		}
+
+		cache.cachedSize = 0u;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+size_t PooledAllocator::GetCachedSize(void) const
+{
+	size_t size = 0u;
+	for (unsigned int i=0; i < CACHE_COUNT; ++i)
+	{
+		Cache& cache = m_caches[i];
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		size += cache.cachedSize;
+	}
+
+	return size;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* PooledAllocator::DoAllocate(size_t size, size_t alignment)
+{
+	PSD_ASSERT(bitUtil::IsPowerOfTwo(alignment), "Alignment must be a power-of-two.");
+
+	if (alignment < BLOCK_ALIGNMENT)
+	{
+		alignment = BLOCK_ALIGNMENT;
+	}
+
+	uint32_t sizeClass = UNPOOLED_CLASS;
+	size_t blockSize = size + alignment;
+	void* block = nullptr;
+	if ((size <= MAX_POOLED_SIZE) && (alignment <= MAX_POOLED_ALIGNMENT))
+	{
+		sizeClass = GetSizeClass(size);
+		blockSize = GetBlockSize(sizeClass);
+
+		Cache* cache = GetThreadCache();
+		std::lock_guard<std::mutex> lock(cache->mutex);
+
+		FreeBlock* freeBlock = cache->freeLists[sizeClass];
+		if (freeBlock)
+		{
+			cache->freeLists[sizeClass] = freeBlock->next;
+			cache->cachedSize -= blockSize;
+			block = freeBlock;
+		}
+	}
+
+	if (!block)
+	{
+		block = AllocateBlock(blockSize);
+		if (!block)
+		{
+			return nullptr;
+		}
+	}
+
+	// blocks are aligned to 16 bytes, so the header and the alignment padding never exceed the extra space of a block
+	const uintptr_t address = bitUtil::RoundUpToMultiple<uintptr_t>(reinterpret_cast<uintptr_t>(block) + sizeof(BlockHeader), alignment);
+	void* ptr = reinterpret_cast<void*>(address);
+
+	BlockHeader* header = GetHeader(ptr);
+	header->block = block;
+	header->sizeClass = sizeClass;
+
+	return ptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void PooledAllocator::DoFree(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	const BlockHeader* header = GetHeader(ptr);
+	void* block = header->block;
+	const uint32_t sizeClass = header->sizeClass;
+	if (sizeClass != UNPOOLED_CLASS)
+	{
+		PSD_ASSERT(sizeClass < SIZE_CLASS_COUNT, "Invalid size class %u, memory was not allocated by this allocator.", sizeClass);
+		const size_t blockSize = GetBlockSize(sizeClass);
+
+		// the block goes into the cache of the freeing thread, which is where it will most likely be needed again
+		Cache* cache = GetThreadCache();
+		std::lock_guard<std::mutex> lock(cache->mutex);
+
+		if (cache->cachedSize + blockSize <= m_maxCachedSizePerThread)
+		{
+			FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+			freeBlock->next = cache->freeLists[sizeClass];
+			cache->freeLists[sizeClass] = freeBlock;
+			cache->cachedSize += blockSize;
+			return;
+		}
+	}
+
+	m_backingAllocator->Free(block);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+PooledAllocator::Cache* PooledAllocator::GetThreadCache(void) const
+{
+	return &m_caches[GetThreadIndex() % CACHE_COUNT];
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* PooledAllocator::AllocateBlock(size_t size)
+{
+	void* block = m_backingAllocator->Allocate(size, BLOCK_ALIGNMENT);
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if (block && m_useHugePages && (size >= HUGE_PAGE_SIZE))
+	{
+		// the advice can only be given for whole pages. the kernel backs each 2 MB-aligned part of the range with a huge
+		// page once it is touched, and the advice sticks with the block while it is cached.
+		const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+		const uintptr_t start = bitUtil::RoundUpToMultiple<uintptr_t>(reinterpret_cast<uintptr_t>(block), pageSize);
+		const uintptr_t end = bitUtil::RoundDownToMultiple<uintptr_t>(reinterpret_cast<uintptr_t>(block) + size, pageSize);
+		if (end > start)
+		{
+			madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE);
+		}
+	}
+#endif
+
+	return block;
+}
+
+PSD_NAMESPACE_END
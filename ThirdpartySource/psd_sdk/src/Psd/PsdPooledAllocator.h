@@ -0,0 +1,53 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdAllocator.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Allocators
+/// \brief Thread-safe allocator that caches freed blocks in per-thread free lists, and reuses them for later allocations.
+/// \details Allocations are rounded up to one of several size classes, with four classes per power-of-two, so that blocks
+/// of e.g. planar channel data can be reused by other layers of similar size. Freed blocks are put into the cache of the
+/// freeing thread, and each thread allocates from its own cache first, so threads extracting layers in parallel rarely
+/// contend with each other or with the backing allocator.
+/// Allocations are aligned to at least 16 bytes, and alignments of up to 64 bytes are served from the cache. Allocations
+/// larger than 256 MB or with a larger alignment are passed on to the backing allocator.
+/// If \a useHugePages is enabled, blocks of 2 MB or more are advised to be backed by transparent huge pages, which reduces
+/// TLB misses when touching large channel planes. This is only supported on Linux, and ignored on all other platforms.
+/// \sa Allocator
+class PooledAllocator : public Allocator
+{
+public:
+	/// Constructor initializing the allocator with a \a backingAllocator that blocks are allocated from. Each thread caches
+	/// at most \a maxCachedSizePerThread bytes of freed blocks, any further blocks are returned to the backing allocator.
+	PooledAllocator(Allocator* backingAllocator, size_t maxCachedSizePerThread, bool useHugePages);
+
+	/// Returns all cached blocks to the backing allocator. All allocations must have been freed before.
+	virtual ~PooledAllocator(void);
+
+	/// Returns all cached blocks to the backing allocator.
+	void Trim(void);
+
+	/// Returns the number of bytes currently held in the caches of all threads.
+	size_t GetCachedSize(void) const;
+
+private:
+	struct Cache;
+
+	virtual void* DoAllocate(size_t size, size_t alignment) PSD_OVERRIDE;
+	virtual void DoFree(void* ptr) PSD_OVERRIDE;
+
+	Cache* GetThreadCache(void) const;
+	void* AllocateBlock(size_t size);
+
+	Allocator* m_backingAllocator;
+	size_t m_maxCachedSizePerThread;
+	bool m_useHugePages;
+	Cache* m_caches;
+};
+
+PSD_NAMESPACE_END
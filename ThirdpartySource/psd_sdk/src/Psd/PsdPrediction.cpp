@@ -0,0 +1,201 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdPrediction.h"
+
+#include "PsdEndianConversion.h"
+#include "PsdSimd.h"
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+#if PSD_USE_SSE
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE __m128i BroadcastLastByte(__m128i value)
+	{
+		// SSE2 has no byte shuffle, so the byte is widened to a word first
+		const __m128i words = _mm_unpackhi_epi8(value, value);
+		const __m128i lastWord = _mm_shufflehi_epi16(words, _MM_SHUFFLE(3, 3, 3, 3));
+		return _mm_unpackhi_epi64(lastWord, lastWord);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE __m128i BroadcastLastWord(__m128i value)
+	{
+		const __m128i lastWord = _mm_shufflehi_epi16(value, _MM_SHUFFLE(3, 3, 3, 3));
+		return _mm_unpackhi_epi64(lastWord, lastWord);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int PrefixSumSSE(uint8_t* data, unsigned int count)
+	{
+		// computes the running sum of all bytes in log-steps within a register, and carries the last sum over into the next one
+		const unsigned int blockCount = count / 16u;
+		__m128i carry = _mm_setzero_si128();
+		for (unsigned int i=0; i < blockCount; ++i)
+		{
+			__m128i* address = reinterpret_cast<__m128i*>(data + i*16u);
+			__m128i sum = _mm_loadu_si128(address);
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 1));
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 2));
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+			sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+			sum = _mm_add_epi8(sum, carry);
+			_mm_storeu_si128(address, sum);
+
+			carry = BroadcastLastByte(sum);
+		}
+
+		return blockCount*16u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int PrefixSumSSE(uint16_t* data, unsigned int count)
+	{
+		const unsigned int blockCount = count / 8u;
+		__m128i carry = _mm_setzero_si128();
+		for (unsigned int i=0; i < blockCount; ++i)
+		{
+			__m128i* address = reinterpret_cast<__m128i*>(data + i*8u);
+			__m128i sum = _mm_loadu_si128(address);
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 2));
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 4));
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 8));
+			sum = _mm_add_epi16(sum, carry);
+			_mm_storeu_si128(address, sum);
+
+			carry = BroadcastLastWord(sum);
+		}
+
+		return blockCount*8u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int InterleavePlanesSSE(const uint8_t* PSD_RESTRICT src0, const uint8_t* PSD_RESTRICT src1, const uint8_t* PSD_RESTRICT src2, const uint8_t* PSD_RESTRICT src3, uint8_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		// plane 0 holds the most significant bytes, so the planes are interleaved in reverse order to yield little-endian values
+		const unsigned int blockCount = count / 16u;
+		for (unsigned int i=0; i < blockCount; ++i, dest += 64u)
+		{
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + i*16u));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + i*16u));
+			const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src2 + i*16u));
+			const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src3 + i*16u));
+
+			const __m128i lo32_lo = _mm_unpacklo_epi8(v3, v2);
+			const __m128i lo32_hi = _mm_unpackhi_epi8(v3, v2);
+			const __m128i hi32_lo = _mm_unpacklo_epi8(v1, v0);
+			const __m128i hi32_hi = _mm_unpackhi_epi8(v1, v0);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(lo32_lo, hi32_lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 16u), _mm_unpackhi_epi16(lo32_lo, hi32_lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 32u), _mm_unpacklo_epi16(lo32_hi, hi32_hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 48u), _mm_unpackhi_epi16(lo32_hi, hi32_hi));
+		}
+
+		return blockCount*16u;
+	}
+#endif
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void PrefixSum(T* data, unsigned int count)
+	{
+		// vectorize as much of the row as possible, and finish the remaining values by carrying the last sum over
+		unsigned int done = 0u;
+#if PSD_USE_SSE
+		done = PrefixSumSSE(data, count);
+#endif
+
+		T previous = (done > 0u) ? data[done - 1u] : T(0);
+		for (unsigned int x = done; x < count; ++x)
+		{
+			previous = static_cast<T>(previous + data[x]);
+			data[x] = previous;
+		}
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyPrediction(uint8_t* data, unsigned int width, unsigned int height)
+	{
+		for (unsigned int y=0; y < height; ++y)
+		{
+			PrefixSum(data + static_cast<size_t>(y)*width, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyPrediction(uint16_t* data, unsigned int width, unsigned int height)
+	{
+		// 16-bit images are delta-encoded word-by-word.
+		// the deltas are big-endian and must be reversed first for further processing. note that this is done
+		// row by row, while the row is still in the cache.
+		for (unsigned int y=0; y < height; ++y)
+		{
+			uint16_t* row = data + static_cast<size_t>(y)*width;
+			endianUtil::BigEndianToNativeArray(row, row, width);
+			PrefixSum(row, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyPrediction(float32_t* data, uint8_t* PSD_RESTRICT rowBuffer, unsigned int width, unsigned int height)
+	{
+		uint8_t* dest = reinterpret_cast<uint8_t*>(data);
+		for (unsigned int y=0; y < height; ++y, dest += width*sizeof(float32_t))
+		{
+			// delta-decode the bytes of the row first
+			PrefixSum(dest, width*4u);
+
+			// the bytes of the 32-bit float are stored in planar fashion per row, big-endian format.
+			// interleave the bytes, and store them in little-endian format at the same time.
+			// note that this operation cannot be done in-place, that's why the row is copied to backup storage first.
+			memcpy(rowBuffer, dest, width*sizeof(float32_t));
+
+			const uint8_t* src0 = rowBuffer;
+			const uint8_t* src1 = rowBuffer + 1*width;
+			const uint8_t* src2 = rowBuffer + 2*width;
+			const uint8_t* src3 = rowBuffer + 3*width;
+
+			unsigned int done = 0u;
+#if PSD_USE_SSE
+			done = InterleavePlanesSSE(src0, src1, src2, src3, dest, width);
+#endif
+
+			for (unsigned int x = done; x < width; ++x)
+			{
+				// write data in little-endian format
+				dest[x*4u + 0u] = src3[x];
+				dest[x*4u + 1u] = src2[x];
+				dest[x*4u + 2u] = src1[x];
+				dest[x*4u + 3u] = src0[x];
+			}
+		}
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,27 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Undoes the horizontal delta coding of 8-bit ZIP_WITH_PREDICTION data in-place, row by row.
+	void ApplyPrediction(uint8_t* data, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Undoes the horizontal delta coding of 16-bit ZIP_WITH_PREDICTION data in-place, row by row.
+	/// The deltas are expected in big-endian format, the resulting values are stored in native-endian format.
+	void ApplyPrediction(uint16_t* data, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Undoes the horizontal delta coding of 32-bit ZIP_WITH_PREDICTION data in-place, row by row.
+	/// Each row stores the big-endian bytes of its values in 4 separate planes, which are interleaved into native-endian values.
+	/// The buffer \a rowBuffer must hold "width*4" bytes.
+	void ApplyPrediction(float32_t* data, uint8_t* PSD_RESTRICT rowBuffer, unsigned int width, unsigned int height);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,24 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdRowSink.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+RowSink::~RowSink(void)
+{
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool RowSink::ProcessRow(unsigned int y, const void* const* rows, unsigned int width)
+{
+	return DoProcessRow(y, rows, width);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,28 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Interfaces
+/// \brief Base class for all consumers of decoded rows.
+/// \details Row sinks receive layer data one row at a time from \ref ExtractLayerRows, so that the data of large layers
+/// can be streamed into e.g. an image encoder or a texture without ever holding the whole layer in memory.
+class RowSink
+{
+public:
+	/// Empty destructor.
+	virtual ~RowSink(void);
+
+	/// Receives row \a y of all requested channels. \a rows holds one row of \a width native-endian values per channel,
+	/// in the order the channels were requested. The rows are only valid until the function returns.
+	/// Returns whether extraction should continue.
+	bool ProcessRow(unsigned int y, const void* const* rows, unsigned int width);
+
+private:
+	virtual bool DoProcessRow(unsigned int y, const void* const* rows, unsigned int width) PSD_ABSTRACT;
+};
+
+PSD_NAMESPACE_END
@@ -0,0 +1,61 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdSimd.h"
+
+#if PSD_USE_AVX2 && PSD_USE_MSVC
+	#include <intrin.h>
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool DetectAvx2(void)
+	{
+#if PSD_USE_AVX2 && PSD_USE_MSVC
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// the OS must save the upper halves of the YMM registers on context switches
+		__cpuid(info, 1);
+		const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+		const bool hasAvx = (info[2] & (1 << 28)) != 0;
+		if (!hasOsxsave || !hasAvx || ((_xgetbv(0) & 6u) != 6u))
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif PSD_USE_AVX2
+		// also checks whether the OS supports saving the YMM registers
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+}
+
+
+namespace simdUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	bool HasAvx2(void)
+	{
+		// thread-safe initialization is guaranteed by C++11
+		static const bool hasAvx2 = DetectAvx2();
+		return hasAvx2;
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,76 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+// This file is used internally by all translation units that contain SIMD code paths.
+// Each path can be disabled by defining the corresponding macro to 0 before including this file.
+
+/// \def PSD_USE_SSE
+/// \ingroup Platform
+/// \brief Enables SSE2 code paths, which are available on all x86-64 CPUs.
+#if !defined(PSD_USE_SSE)
+	#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__) || defined(__x86_64__)
+		#define PSD_USE_SSE 1
+	#else
+		#define PSD_USE_SSE 0
+	#endif
+#endif
+
+/// \def PSD_USE_AVX2
+/// \ingroup Platform
+/// \brief Enables AVX2 code paths, which are compiled in addition to the SSE2 paths and selected at runtime, see \ref simdUtil::HasAvx2.
+#if !defined(PSD_USE_AVX2)
+	#if PSD_USE_SSE && (PSD_USE_MSVC || PSD_USE_GCC || PSD_USE_CLANG)
+		#define PSD_USE_AVX2 1
+	#else
+		#define PSD_USE_AVX2 0
+	#endif
+#endif
+
+/// \def PSD_USE_NEON
+/// \ingroup Platform
+/// \brief Enables NEON code paths, which are available on all ARMv8 CPUs.
+#if !defined(PSD_USE_NEON)
+	#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+		#define PSD_USE_NEON 1
+	#else
+		#define PSD_USE_NEON 0
+	#endif
+#endif
+
+/// \def PSD_TARGET_AVX2
+/// \ingroup Platform
+/// \brief Marks a function that uses AVX2 instructions, so that it can be compiled without enabling AVX2 for the whole translation unit.
+#if PSD_USE_GCC || PSD_USE_CLANG
+	#define PSD_TARGET_AVX2								__attribute__((target("avx2")))
+#else
+	#define PSD_TARGET_AVX2
+#endif
+
+#if PSD_USE_SSE
+	#include <emmintrin.h>
+#endif
+
+#if PSD_USE_AVX2
+	#include <immintrin.h>
+#endif
+
+#if PSD_USE_NEON
+	#include <arm_neon.h>
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Util
+/// \namespace simdUtil
+/// \brief Provides runtime detection of SIMD instruction sets.
+namespace simdUtil
+{
+	/// Returns whether the CPU and the operating system support AVX2 instructions. The result is cached after the first call.
+	bool HasAvx2(void);
+}
+
+PSD_NAMESPACE_END
@@ -5,28 +5,112 @@
 #include "PsdSyncFileReader.h"
 
 #include "PsdFile.h"
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include "PsdBitUtil.h"
+#include <cstring>
 
 
 PSD_NAMESPACE_BEGIN
 
+namespace
+{
+	// the read window always starts at a page boundary and is a multiple of the page size
+	static const uint32_t PAGE_SIZE = 4096u;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 SyncFileReader::SyncFileReader(File* file)
 	: m_file(file)
 	, m_position(0ull)
+	, m_allocator(nullptr)
+	, m_data(nullptr)
+	, m_window(nullptr)
+	, m_windowSize(0u)
+	, m_windowStart(0ull)
+	, m_windowLength(0u)
+	, m_fileSize(0ull)
 {
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+SyncFileReader::SyncFileReader(File* file, Allocator* allocator, uint32_t windowSize)
+	: m_file(file)
+	, m_position(0ull)
+	, m_allocator(allocator)
+	, m_data(nullptr)
+	, m_window(nullptr)
+	, m_windowSize(bitUtil::RoundUpToMultiple(windowSize > 0u ? windowSize : PAGE_SIZE, PAGE_SIZE))
+	, m_windowStart(0ull)
+	, m_windowLength(0u)
+	, m_fileSize(file->GetSize())
+{
+	// files whose contents already are in memory don't need a window, we copy straight from there.
+	// without knowing the file size we cannot clamp reads to the end of the file, so fall back to unbuffered reads.
+	m_data = static_cast<const uint8_t*>(file->GetData(0ull, m_fileSize));
+	if (!m_data && (m_fileSize != 0ull))
+	{
+		m_window = static_cast<uint8_t*>(m_allocator->Allocate(m_windowSize, 16u));
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+SyncFileReader::~SyncFileReader(void)
+{
+	if (m_window)
+	{
+		m_allocator->Free(m_window);
+	}
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void SyncFileReader::Read(void* buffer, uint32_t count)
 {
-	// do an asynchronous read, wait until it's finished, and update the file position
-	File::ReadOperation op = m_file->Read(buffer, count, m_position);
-	m_file->WaitForRead(op);
+	if (m_data && (m_position <= m_fileSize) && (count <= m_fileSize - m_position))
+	{
+		memcpy(buffer, m_data + m_position, count);
+		m_position += count;
+		return;
+	}
 
-	m_position += count;
+	if (!m_window)
+	{
+		ReadFromFile(buffer, count, m_position);
+		m_position += count;
+		return;
+	}
+
+	uint8_t* dest = static_cast<uint8_t*>(buffer);
+	while (count > 0u)
+	{
+		if ((m_position >= m_windowStart) && (m_position < m_windowStart + m_windowLength))
+		{
+			// serve as much as possible from the current window
+			const uint32_t offset = static_cast<uint32_t>(m_position - m_windowStart);
+			const uint32_t available = m_windowLength - offset;
+			const uint32_t toCopy = (count < available) ? count : available;
+			memcpy(dest, m_window + offset, toCopy);
+
+			dest += toCopy;
+			count -= toCopy;
+			m_position += toCopy;
+		}
+		else if ((count >= m_windowSize) || !FillWindow(m_position))
+		{
+			// large reads go straight into the caller's buffer, and so do reads outside the file
+			ReadFromFile(dest, count, m_position);
+			m_position += count;
+			return;
+		}
+	}
 }
 
 
@@ -53,4 +137,36 @@ uint64_t SyncFileReader::GetPosition(void) const
 	return m_position;
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void SyncFileReader::ReadFromFile(void* buffer, uint32_t count, uint64_t position)
+{
+	// do an asynchronous read and wait until it's finished
+	File::ReadOperation op = m_file->Read(buffer, count, position);
+	m_file->WaitForRead(op);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool SyncFileReader::FillWindow(uint64_t position)
+{
+	if (position >= m_fileSize)
+	{
+		return false;
+	}
+
+	// never read past the end of the file, some implementations treat this as an error
+	const uint64_t start = bitUtil::RoundDownToMultiple<uint64_t>(position, PAGE_SIZE);
+	const uint64_t leftInFile = m_fileSize - start;
+	const uint32_t length = (leftInFile < m_windowSize) ? static_cast<uint32_t>(leftInFile) : m_windowSize;
+
+	ReadFromFile(m_window, length, start);
+	m_windowStart = start;
+	m_windowLength = length;
+
+	return true;
+}
+
 PSD_NAMESPACE_END
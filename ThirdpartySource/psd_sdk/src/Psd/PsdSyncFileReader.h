@@ -7,6 +7,7 @@
 PSD_NAMESPACE_BEGIN
 
 class File;
+class Allocator;
 
 
 /// \ingroup Files
@@ -14,14 +15,30 @@ class File;
 /// \details In certain situations, working with synchronous read operations is much easier than having to deal with a number
 /// of asynchronous reads, keeping track of individual read operations. This is especially true when parsing a file sequentially,
 /// where different read operations depend on previous ones.
+///
+/// When constructed with an allocator, the reader keeps a page-aligned read window of the file in memory. Small reads are then
+/// served from the window, and only a miss goes to the underlying \ref File. Reads that are at least as large as the window bypass
+/// it and go straight into the caller's buffer. If the file's contents are accessible in memory (see File::GetData()), no window
+/// is allocated and reads copy directly from the file's memory.
 /// \sa File
 class SyncFileReader
 {
 public:
-	/// Constructor initializing the internal read position to zero.
+	/// Size of the read window used by the buffered constructor unless specified otherwise.
+	static const uint32_t DEFAULT_WINDOW_SIZE = 64u * 1024u;
+
+	/// Constructor initializing the internal read position to zero. Each call to Read() directly reads from the file.
 	/// \remark The given \a file must already be open.
 	explicit SyncFileReader(File* file);
 
+	/// Constructor initializing the internal read position to zero, using a read window of \a windowSize bytes
+	/// allocated from \a allocator. The window size is rounded up to a multiple of the page size.
+	/// \remark The given \a file must already be open.
+	SyncFileReader(File* file, Allocator* allocator, uint32_t windowSize = DEFAULT_WINDOW_SIZE);
+
+	/// Destructor freeing the read window, if any.
+	~SyncFileReader(void);
+
 	/// Reads \a count bytes into \a buffer synchronously, incrementing the internal read position.
 	void Read(void* buffer, uint32_t count);
 
@@ -35,8 +52,22 @@ public:
 	uint64_t GetPosition(void) const;
 
 private:
+	SyncFileReader(const SyncFileReader&);
+	SyncFileReader& operator=(const SyncFileReader&);
+
+	void ReadFromFile(void* buffer, uint32_t count, uint64_t position);
+	bool FillWindow(uint64_t position);
+
 	File* m_file;
 	uint64_t m_position;
+
+	Allocator* m_allocator;
+	const uint8_t* m_data;
+	uint8_t* m_window;
+	uint32_t m_windowSize;
+	uint64_t m_windowStart;
+	uint32_t m_windowLength;
+	uint64_t m_fileSize;
 };
 
 PSD_NAMESPACE_END
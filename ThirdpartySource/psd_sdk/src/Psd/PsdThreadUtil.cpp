@@ -0,0 +1,22 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdThreadUtil.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace threadUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	unsigned int GetHardwareThreadCount(void)
+	{
+		// hardware_concurrency() is allowed to return 0 if the value is not computable
+		const unsigned int count = std::thread::hardware_concurrency();
+		return (count == 0u) ? 1u : count;
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,33 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Util
+/// \namespace threadUtil
+/// \brief Provides simple multi-threading utilities.
+namespace threadUtil
+{
+	/// The maximum number of threads used by \ref ParallelFor, including the calling thread.
+	static const unsigned int MAX_THREAD_COUNT = 64u;
+
+	/// Returns the number of hardware threads, but at least 1.
+	unsigned int GetHardwareThreadCount(void);
+
+	/// \brief Calls \a function for each index in [0, \a count) using up to \a threadCount threads, including the calling thread.
+	/// \details Indices are handed out to threads in ascending order, one at a time, so work that is sorted by cost
+	/// is balanced automatically. A \a threadCount of 0 uses all hardware threads.
+	/// The function returns once all indices have been processed.
+	template <typename F>
+	inline void ParallelFor(unsigned int count, unsigned int threadCount, const F& function);
+}
+
+#include "PsdThreadUtil.inl"
+
+PSD_NAMESPACE_END
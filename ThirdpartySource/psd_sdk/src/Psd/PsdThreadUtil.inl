@@ -0,0 +1,68 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+namespace threadUtil
+{
+	namespace detail
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <typename F>
+		inline void Work(std::atomic<unsigned int>* next, unsigned int count, const F* function)
+		{
+			for (;;)
+			{
+				const unsigned int index = next->fetch_add(1u, std::memory_order_relaxed);
+				if (index >= count)
+				{
+					return;
+				}
+
+				(*function)(index);
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename F>
+	inline void ParallelFor(unsigned int count, unsigned int threadCount, const F& function)
+	{
+		if (threadCount == 0u)
+		{
+			threadCount = GetHardwareThreadCount();
+		}
+
+		if (threadCount > count)
+		{
+			threadCount = count;
+		}
+
+		if (threadCount > MAX_THREAD_COUNT)
+		{
+			threadCount = MAX_THREAD_COUNT;
+		}
+
+		std::atomic<unsigned int> next(0u);
+		if (threadCount <= 1u)
+		{
+			detail::Work(&next, count, &function);
+			return;
+		}
+
+		// the calling thread participates in the work as well
+		std::thread threads[MAX_THREAD_COUNT - 1u];
+		for (unsigned int i=0; i < threadCount - 1u; ++i)
+		{
+			threads[i] = std::thread(&detail::Work<F>, &next, count, &function);
+		}
+
+		detail::Work(&next, count, &function);
+
+		for (unsigned int i=0; i < threadCount - 1u; ++i)
+		{
+			threads[i].join();
+		}
+	}
+}
@@ -0,0 +1,240 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdTrackingAllocator.h"
+
+#include "PsdAssert.h"
+#include "PsdBitUtil.h"
+#include "Psdinttypes.h"
+#include <cstdio>
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	static const char* const UNTAGGED = "untagged";
+	static const char* const OTHER = "other";
+
+
+	/// Stored right in front of each allocation, so that freeing it knows its size and tag.
+	struct AllocationHeader
+	{
+		size_t size;
+		uint32_t offset;					///< The offset of the allocation from the start of the block allocated from the backing allocator.
+		uint32_t tagIndex;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InitializeStats(TrackingAllocator::Stats& stats, const char* tag)
+	{
+		stats.tag = tag;
+		stats.allocationCount = 0ull;
+		stats.liveCount = 0ull;
+		stats.liveSize = 0ull;
+		stats.peakSize = 0ull;
+		stats.largestAllocation = 0ull;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void AddAllocation(TrackingAllocator::Stats& stats, size_t size)
+	{
+		++stats.allocationCount;
+		++stats.liveCount;
+		stats.liveSize += size;
+		if (stats.liveSize > stats.peakSize)
+		{
+			stats.peakSize = stats.liveSize;
+		}
+
+		if (size > stats.largestAllocation)
+		{
+			stats.largestAllocation = size;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void RemoveAllocation(TrackingAllocator::Stats& stats, size_t size)
+	{
+		PSD_ASSERT((stats.liveCount > 0u) && (stats.liveSize >= size), "Allocation of %" PRIu64 " bytes was not tracked.", static_cast<uint64_t>(size));
+		--stats.liveCount;
+		stats.liveSize -= size;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void PrintStats(const TrackingAllocator::Stats& stats)
+	{
+		printf("%-20s %12" PRIu64 " %12" PRIu64 " %16" PRIu64 " %16" PRIu64 " %16" PRIu64 "\n", stats.tag ? stats.tag : "total",
+			stats.allocationCount, stats.liveCount, stats.liveSize, stats.peakSize, stats.largestAllocation);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+TrackingAllocator::TrackingAllocator(Allocator* backingAllocator)
+	: m_backingAllocator(backingAllocator)
+	, m_tagCount(0u)
+{
+	PSD_ASSERT_NOT_NULL(backingAllocator);
+
+	InitializeStats(m_stats, nullptr);
+	for (unsigned int i=0; i < MAX_TAG_COUNT; ++i)
+	{
+		InitializeStats(m_tagStats[i], nullptr);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+TrackingAllocator::Stats TrackingAllocator::GetStats(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+unsigned int TrackingAllocator::GetTagCount(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_tagCount;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+TrackingAllocator::Stats TrackingAllocator::GetTagStats(unsigned int index) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	PSD_ASSERT(index < m_tagCount, "Tag index %u is out of range.", index);
+
+	return m_tagStats[index];
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void TrackingAllocator::PrintReport(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	printf("%-20s %12s %12s %16s %16s %16s\n", "tag", "allocations", "live", "live bytes", "peak bytes", "largest");
+	for (unsigned int i=0; i < m_tagCount; ++i)
+	{
+		PrintStats(m_tagStats[i]);
+	}
+
+	PrintStats(m_stats);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* TrackingAllocator::DoAllocate(size_t size, size_t alignment)
+{
+	return DoAllocateTagged(size, alignment, nullptr);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void* TrackingAllocator::DoAllocateTagged(size_t size, size_t alignment, const char* tag)
+{
+	PSD_ASSERT(bitUtil::IsPowerOfTwo(alignment), "Alignment must be a power-of-two.");
+
+	// the header is put in front of the allocation, padded so that both the allocation and the header are properly aligned
+	const size_t headerAlignment = PSD_ALIGN_OF(AllocationHeader);
+	const size_t blockAlignment = (alignment > headerAlignment) ? alignment : headerAlignment;
+	const size_t offset = bitUtil::RoundUpToMultiple<size_t>(sizeof(AllocationHeader), blockAlignment);
+	uint8_t* block = static_cast<uint8_t*>(m_backingAllocator->Allocate(offset + size, blockAlignment, tag));
+	if (!block)
+	{
+		return nullptr;
+	}
+
+	AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block + offset - sizeof(AllocationHeader));
+	header->size = size;
+	header->offset = static_cast<uint32_t>(offset);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		header->tagIndex = FindTag(tag ? tag : UNTAGGED);
+		AddAllocation(m_tagStats[header->tagIndex], size);
+		AddAllocation(m_stats, size);
+	}
+
+	return block + offset;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void TrackingAllocator::DoFree(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	uint8_t* allocation = static_cast<uint8_t*>(ptr);
+	const AllocationHeader* header = reinterpret_cast<const AllocationHeader*>(allocation - sizeof(AllocationHeader));
+	const size_t size = header->size;
+	const unsigned int tagIndex = header->tagIndex;
+	uint8_t* block = allocation - header->offset;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		RemoveAllocation(m_tagStats[tagIndex], size);
+		RemoveAllocation(m_stats, size);
+	}
+
+	m_backingAllocator->Free(block);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+unsigned int TrackingAllocator::FindTag(const char* tag)
+{
+	// the same tag may be stored at different addresses in different translation units, so tags are compared by their contents.
+	// there are only a handful of tags, and they are mostly found in the first few entries.
+	for (unsigned int i=0; i < m_tagCount; ++i)
+	{
+		const char* other = m_tagStats[i].tag;
+		if ((other == tag) || (strcmp(other, tag) == 0))
+		{
+			return i;
+		}
+	}
+
+	// the last entry is reserved for all tags that do not fit anymore
+	if (m_tagCount == MAX_TAG_COUNT - 1u)
+	{
+		InitializeStats(m_tagStats[m_tagCount], OTHER);
+		return m_tagCount++;
+	}
+	else if (m_tagCount == MAX_TAG_COUNT)
+	{
+		return MAX_TAG_COUNT - 1u;
+	}
+
+	InitializeStats(m_tagStats[m_tagCount], tag);
+	return m_tagCount++;
+}
+
+PSD_NAMESPACE_END
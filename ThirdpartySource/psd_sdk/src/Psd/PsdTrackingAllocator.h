@@ -0,0 +1,68 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdAllocator.h"
+#include <mutex>
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Allocators
+/// \brief Allocator that forwards all allocations to a backing allocator, and keeps statistics about them.
+/// \details The allocator tracks the number of bytes currently allocated, the peak number of bytes allocated at once,
+/// the number of allocations, and the largest single allocation, both in total and for each tag passed to
+/// \ref Allocator::Allocate. The parser attributes its allocations to the tags in \ref allocationTag, and allocations
+/// without a tag are attributed to "untagged". This helps finding out how much memory importing a document needs, and what
+/// it is needed for.
+/// Tags are only stored by pointer, so they must outlive the allocator. The allocator is thread-safe if the backing
+/// allocator is.
+/// \sa Allocator allocationTag
+class TrackingAllocator : public Allocator
+{
+public:
+	/// The maximum number of distinct tags that are tracked. Allocations with further tags are attributed to "other".
+	static const unsigned int MAX_TAG_COUNT = 32u;
+
+	/// Statistics about the allocations attributed to a tag, or about all allocations.
+	struct Stats
+	{
+		const char* tag;						///< The tag, or nullptr for the statistics of all allocations.
+		uint64_t allocationCount;				///< The number of allocations made so far.
+		uint64_t liveCount;						///< The number of allocations that have not been freed yet.
+		uint64_t liveSize;						///< The number of bytes that have not been freed yet.
+		uint64_t peakSize;						///< The highest number of bytes that were allocated at the same time.
+		uint64_t largestAllocation;				///< The size of the largest single allocation.
+	};
+
+	/// Constructor initializing the allocator with a \a backingAllocator that all allocations are forwarded to.
+	explicit TrackingAllocator(Allocator* backingAllocator);
+
+	/// Returns the statistics about all allocations.
+	Stats GetStats(void) const;
+
+	/// Returns the number of tags that allocations have been attributed to so far.
+	unsigned int GetTagCount(void) const;
+
+	/// Returns the statistics about the allocations attributed to the tag with the given \a index, in the order the tags were first used.
+	Stats GetTagStats(unsigned int index) const;
+
+	/// Prints a report of all statistics, with one line for each tag.
+	void PrintReport(void) const;
+
+private:
+	virtual void* DoAllocate(size_t size, size_t alignment) PSD_OVERRIDE;
+	virtual void* DoAllocateTagged(size_t size, size_t alignment, const char* tag) PSD_OVERRIDE;
+	virtual void DoFree(void* ptr) PSD_OVERRIDE;
+
+	unsigned int FindTag(const char* tag);
+
+	Allocator* m_backingAllocator;
+	Stats m_stats;
+	Stats m_tagStats[MAX_TAG_COUNT];
+	unsigned int m_tagCount;
+	mutable std::mutex m_mutex;
+};
+
+PSD_NAMESPACE_END
@@ -288,11 +288,12 @@ int SampleReadPsd(void)
 	{
 		hasTransparencyMask = layerMaskSection->hasTransparencyMask;
 
-		// extract all layers one by one. this should be done in parallel for maximum efficiency.
+		// extract all layers in parallel, using all hardware threads. both the file and the allocator are thread-safe.
+		ExtractLayersParallel(document, &file, &allocator, layerMaskSection->layers, layerMaskSection->layerCount, 0u);
+
 		for (unsigned int i = 0; i < layerMaskSection->layerCount; ++i)
 		{
 			Layer* layer = &layerMaskSection->layers[i];
-			ExtractLayer(document, &file, &allocator, layer);
 
 			// check availability of R, G, B, and A channels.
 			// we need to determine the indices of channels individually, because there is no guarantee that R is the first channel,